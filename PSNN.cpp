@@ -5,31 +5,31 @@
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <onnxruntime_cxx_api.h>
 
 #include "PSNN.h"
+#include "PSNN_bulk.h"
+#include "PSNN_features.h"
+#include "PSNN_summary.h"
+#include "PSNN_shm.h"
 
 //Drop the elements from the vector that do not show variance in the pyton script.
 int drop(std::vector<std::string>& names, std::vector<double>& scores) {
-
-    std::vector<std::string> dropNames{"SRCompatF(A)1","SRCompatF(A)2","SRCompatF(A)3",
-        "SRCompatS(A)1","SRCompatS(A)2", "SRCompatS(A)3",
-        "RCompatXF(A)1","RCompatXF(A)2","RCompatXF(A)3",
-        "RCompatXS(A)1", "RCompatXS(A)2","RCompatXS(A)3",
-        "SetTot(1:A)1","SetTot(1:A)2","SetTot(1:A)3", "Consensus(A:0)1", "Consensus(A:0)2",
-        "Consensus(A:0)3", "Consensus(A:1)1", "Consensus(A:1)2", "Consensus(A:1)3",
-        "Consensus(A:2)1", "Consensus(A:2)2", "Consensus(A:2)3"
-    };
-
-    // Remove elements from names and scores if the name is in dropNames
-    for (size_t i = 0; i < names.size(); ) {
-        if (std::find(dropNames.begin(), dropNames.end(), names[i]) != dropNames.end()) {
-            names.erase(names.begin() + i);
-            scores.erase(scores.begin() + i);
-        } else {
-            ++i;
+    // Keep the elements of names and scores whose feature the preprocessing plan does not drop
+    size_t kept = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (isDroppedFeature(names[i])) {
+            continue;
+        }
+        if (kept != i) {
+            names[kept] = std::move(names[i]);
+            scores[kept] = scores[i];
         }
+        kept++;
     }
+    names.resize(kept);
+    scores.resize(kept);
         
     return 0;
 }
@@ -37,73 +37,30 @@ int drop(std::vector<std::string>& names, std::vector<double>& scores) {
 
 //Standardise the remaining scores using the means and standard deviations from the python script.
 int standardise(std::vector<std::string>& names, std::vector<double>& scores){
-    std::vector<double> stdDev{77.81935754, 78.61500891, 78.49932003, 0.33135391, 0.3302249,
-        0.33013326,  0.47501296,  0.45518937,  0.45380344,  0.43516053,
-        0.41983258, 0.42051523, 0.42452919, 0.40729272, 0.40618444,
-        0.42237544, 0.40565562, 0.40395664, 9.18215223, 8.87685838,
-        8.79940741, 0.29372744, 0.29004331, 0.28246039, 0.45595758,
-        0.44363619, 0.44087034, 0.27690231, 0.27243035, 0.27253431,
-        2.30955365, 2.26208653, 2.25805451, 0.29305205, 0.29300839,
-        0.29317703, 2.62412539, 2.66208001, 2.75144994, 0.23280591,
-        0.23614036, 0.23754669, 0.71210972, 0.73173777, 0.76329215,
-        0.10588893, 0.10604115, 0.1073419, 2.5910722, 2.63099812,
-        2.71640149, 0.22258118, 0.22258118, 0.22258118, 0.7824096,
-        0.81190509, 0.85185175, 0.09563661, 0.09563661, 0.09563661,
-        0.98819725, 1.04309565, 1.06479416, 1.00704312, 1.05179805,
-        1.07383432, 9.91944706, 9.84952037, 9.67515909, 1.59625999,
-        1.606194, 1.695653, 0.79266336, 0.82650908, 0.82976458,
-        0.22446628, 0.22453972, 0.22425348, 0.12584292, 0.12653409,
-        0.12659368, 56.66741131, 56.56714733, 56.6054163, 5.2931978,
-        5.51612525, 5.7820158, 47.38165939, 47.11818704, 47.63537705,
-       47.81972043, 47.4848627, 47.60851212,  0.21678955,  0.21445225,0.21430079 };
-
-    std::vector<double> means{93.64829657377209,94.9787838666968,94.9850292246585,0.1652282657021991,0.13167896018342107,
-        0.1261814410178577,0.34391448961798043,0.29311202247553847,0.290089450059741,0.4035286001872961,0.4692451581360804,
-        0.4790747803145283,0.34072728498078597,0.39561142345077027,0.4007465964413731,0.3378896775276908,0.3926582591791263,
-        0.39667262815254944,8.534188397590984,8.138416175767754,8.035000038001742,0.14400886621241968,0.13566300113023544,0.1323365148060839,
-        0.29481060483740756,0.2693770788258469,0.2641327865146769,0.49313046145897244,0.45780350050053287,0.4528006135563666,1.9242273064875508,
-        1.8578602447766979,1.8517204830949072,0.41068983543772397,0.38140402331514195,0.3787053476927051,2.291025930829593,2.5652985436109406,
-        2.6910582232699327,0.018529402266929312,0.019362547227693996,0.01950463396518875,0.0891335938256854,0.09324119223689734,0.09845319210772759,
-        0.002434850001614622,0.0024413084896825654,0.0024736009300222817,2.297264830303226,2.5751089869861468,2.704898763199535,0.01568766751703426,
-        0.01568766751703426,0.01568766751703426,0.11023347434365614,0.11721509994510285,0.12358316918009495,0.0023056802402557563,0.0023056802402557563,
-        0.0023056802402557563,0.2794264862595666,0.30316788839732617,0.31430878031452836,0.29001840669099366,0.31255853004811573,0.3237575483579294,
-        7.34176035643104,7.0250873698194845,6.9248489843833765,1.1292924726321567,1.2199631866180127,1.3192043142700294,1.0061291051764782,0.9959505279813996,
-        0.9979203668421223,0.3967839035747731,0.3919100010979429,0.39125673433009334,0.18867358949849838,0.1918002263700068,0.1927855593373591,-11.044021054671102,
-        -13.168644040430136,-13.399354151193206,3.154015564956244,3.225704782510414,3.483837633609972,61.81170923886718,60.48893338069558,60.484057222204285,
-        60.04446023185972,58.992721283947425,58.86758161914296,0.528549646892492,0.5111502837005976,0.5075989531249846};
-    
     // Check if we have enough standardization parameters
-    if (names.size() > stdDev.size() || names.size() > means.size()) {
+    if (names.size() > KEPT_FEATURE_COUNT) {
         std::cerr << "Error: Not enough standardization parameters for all data entries." << std::endl;
-        std::cerr << "Data entries: " << names.size() << ", stdDev size: " << stdDev.size() 
-                  << ", means size: " << means.size() << std::endl;
+        std::cerr << "Data entries: " << names.size() << ", parameters: " << KEPT_FEATURE_COUNT << std::endl;
         return 1;
     }
     
-    // Apply standardization with division by zero check
+    // Apply standardization; constant features have no scale and become 0
     for (size_t i = 0; i < names.size(); i++) {
-        // Check for division by zero or very small values
-        if (std::abs(stdDev[i]) < 1e-10) {
+        if (PLAN_SCALE[i] == 0.0) {
             std::cerr << "Warning: Near-zero standard deviation for " << names[i] 
-                      << " (" << stdDev[i] << "). Setting result to 0." << std::endl;
+                      << " (" << STD_DEV[i] << "). Setting result to 0." << std::endl;
+            scores[i] = 0.0;
+            continue;
+        }
+        double raw = scores[i];
+        scores[i] = standardiseValue(i, raw);
+        
+        // Check for infinity or NaN
+        if (!std::isfinite(scores[i])) {
+            std::cerr << "Warning: Non-finite value produced for " << names[i] 
+                      << ". Input: " << raw << ", Mean: " << MEANS[i] 
+                      << ", StdDev: " << STD_DEV[i] << ". Setting to 0." << std::endl;
             scores[i] = 0.0;
-        } else {
-            // Safe standardization with bounds checking
-            try {
-                scores[i] = (scores[i] - means[i]) / stdDev[i];
-                
-                // Check for infinity or NaN
-                if (!std::isfinite(scores[i])) {
-                    std::cerr << "Warning: Non-finite value produced for " << names[i] 
-                              << ". Input: " << scores[i] << ", Mean: " << means[i] 
-                              << ", StdDev: " << stdDev[i] << ". Setting to 0." << std::endl;
-                    scores[i] = 0.0;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Exception during standardization for " << names[i] << ": " 
-                          << e.what() << std::endl;
-                scores[i] = 0.0;
-            }
         }
     }
 
@@ -249,9 +206,159 @@ int inference(std::vector<std::string>& input_name, std::vector<double>& input_t
     }
 }
 
+static void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--input FILE [--format txt|csv|bin|sparse] [--output FILE] [--model FILE]" << std::endl
+              << "        [--workers N] [--numa] [--batch ROWS] [--summary FILE [--thresholds P,P,...]] [--no-events]" << std::endl
+              << "        [--trace FILE [--trace-sample RATE] [--trace-ort]] [--chunk ROWS] [--resume]" << std::endl
+              << "        [--drift FILE [--drift-shift SD] [--drift-ratio R] [--drift-abort]]" << std::endl
+              << "        [--store FILE --ids FILE]]" << std::endl
+              << "       " << prog << " --serve-shm NAME [--model FILE] [--slots N] [--batch ROWS] [--threads N]"
+              << " [--drift FILE]" << std::endl
+              << "Without --input, scores the single event in sharedData.txt." << std::endl;
+}
+
+// Parse bulk-mode arguments; returns false on a usage error
+static bool parseBulkArgs(int argc, char** argv, BulkOptions& options) {
+    bool have_format = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--numa") {
+            options.numa = true;
+            continue;
+        }
+        if (arg == "--no-events") {
+            options.write_events = false;
+            continue;
+        }
+        if (arg == "--trace-ort") {
+            options.trace_ort = true;
+            continue;
+        }
+        if (arg == "--resume") {
+            options.resume = true;
+            continue;
+        }
+        if (arg == "--drift-abort") {
+            options.drift_abort = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--input") {
+            options.input_path = value;
+        } else if (arg == "--output") {
+            options.output_path = value;
+        } else if (arg == "--model") {
+            options.model_path = value;
+        } else if (arg == "--format") {
+            if (!parseEventFormat(value, options.input_format)) return false;
+            have_format = true;
+        } else if (arg == "--workers") {
+            options.workers = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--batch") {
+            options.batch_rows = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--chunk") {
+            options.chunk_rows = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--summary") {
+            options.summary_path = value;
+        } else if (arg == "--trace") {
+            options.trace_path = value;
+        } else if (arg == "--trace-sample") {
+            options.trace_sample_rate = std::atof(value.c_str());
+            if (options.trace_sample_rate <= 0.0 || options.trace_sample_rate > 1.0) return false;
+        } else if (arg == "--thresholds") {
+            if (!parseThresholds(value, options.thresholds)) return false;
+        } else if (arg == "--drift") {
+            options.drift_path = value;
+        } else if (arg == "--store") {
+            options.store_path = value;
+        } else if (arg == "--ids") {
+            options.ids_path = value;
+        } else if (arg == "--drift-shift") {
+            options.drift.max_mean_shift = std::atof(value.c_str());
+            if (options.drift.max_mean_shift <= 0.0) return false;
+        } else if (arg == "--drift-ratio") {
+            options.drift.max_variance_ratio = std::atof(value.c_str());
+            if (options.drift.max_variance_ratio <= 1.0) return false;
+        } else {
+            return false;
+        }
+    }
+
+    if (options.input_path.empty()) {
+        return false;
+    }
+    if (!options.write_events && options.summary_path.empty() && options.store_path.empty()) {
+        std::cerr << "Error: --no-events needs --summary or --store." << std::endl;
+        return false;
+    }
+    if (options.store_path.empty() != options.ids_path.empty()) {
+        std::cerr << "Error: --store and --ids go together." << std::endl;
+        return false;
+    }
+    if (options.drift_abort && options.drift_path.empty()) {
+        std::cerr << "Error: --drift-abort needs --drift." << std::endl;
+        return false;
+    }
+    if (!have_format && !eventFormatFromPath(options.input_path, options.input_format)) {
+        std::cerr << "Error: Cannot infer the format of " << options.input_path << ", pass --format." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Parse --serve-shm arguments; returns false on a usage error
+static bool parseServeArgs(int argc, char** argv, ServeOptions& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--serve-shm") {
+            options.shm_name = value[0] == '/' ? value : "/" + value;
+        } else if (arg == "--model") {
+            options.model_path = value;
+        } else if (arg == "--slots") {
+            int slots = std::atoi(value.c_str());
+            if (slots < static_cast<int>(SHM_MIN_SLOTS)) {
+                std::cerr << "Error: --slots must be at least " << SHM_MIN_SLOTS << "." << std::endl;
+                return false;
+            }
+            options.slots = static_cast<uint32_t>(slots);
+        } else if (arg == "--batch") {
+            options.batch_rows = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--threads") {
+            options.threads = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--drift") {
+            options.drift_path = value;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1;
+}
+
 // Main function
-// Reads data from a file, processes it, and prints the results
-int main(){
+// Reads data from a file, processes it, and prints the results.
+// With --input, scores every event of a (possibly large) event file instead.
+int main(int argc, char** argv){
+    if (argc > 2 && std::string(argv[1]) == "--serve-shm") {
+        ServeOptions options;
+        if (!parseServeArgs(argc, argv, options)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return runShmServer(options);
+    }
+    if (argc > 1) {
+        BulkOptions options;
+        if (!parseBulkArgs(argc, argv, options)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return runBulk(options);
+    }
+
     std::vector<std::string> names;
     std::vector<double> scores;
     
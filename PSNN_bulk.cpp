@@ -0,0 +1,1006 @@
+// PSNN_bulk.cpp - Bulk scoring of event files, optionally sharded across pinned worker processes
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <atomic>
+#include <new>
+#include <filesystem>
+#include <onnxruntime_cxx_api.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <signal.h>
+#endif
+
+#include "PSNN_bulk.h"
+#include "PSNN_features.h"
+#include "PSNN_summary.h"
+#include "PSNN_drift.h"
+#include "PSNN_trace.h"
+#include "PSNN_shm.h"
+#include "PSNN_store.h"
+
+// Read-only view of the model file, shared by all workers
+struct ModelBytes {
+    const void* data = nullptr;
+    size_t size = 0;
+    std::vector<char> owned;  // Fallback storage when the file cannot be mapped
+};
+
+static int mapModel(const std::string& path, ModelBytes& model) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                model.data = p;
+                model.size = st.st_size;
+                ::close(fd);
+                return 0;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open model " << path << std::endl;
+        return 1;
+    }
+    model.owned.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    model.data = model.owned.data();
+    model.size = model.owned.size();
+    return 0;
+}
+
+static void unmapModel(ModelBytes& model) {
+#ifndef _WIN32
+    if (model.owned.empty() && model.data) {
+        munmap(const_cast<void*>(model.data), model.size);
+    }
+#endif
+    model.data = nullptr;
+    model.size = 0;
+    model.owned.clear();
+}
+
+// Raw events of a bulk run, kept in the layout they were read in
+struct EventTable {
+    std::vector<double> dense;  // FEATURE_COUNT values per row
+    SparseEvents sparse;        // Used instead of dense for Sparse input
+    bool is_sparse = false;
+
+    size_t rows() const {
+        return is_sparse ? sparse.rows() : dense.size() / FEATURE_COUNT;
+    }
+
+    // Standardise one row; sparse rows only touch their non-zero entries
+    void standardise(size_t row, float* out, uint32_t* zeroed) const {
+        if (is_sparse) {
+            uint64_t first = sparse.row_offsets[row];
+            standardiseSparse(sparse.indices.data() + first, sparse.values.data() + first,
+                              sparse.row_offsets[row + 1] - first, out, zeroed);
+        } else {
+            standardiseRow(dense.data() + row * FEATURE_COUNT, out, zeroed);
+        }
+    }
+};
+
+static int loadTable(const BulkOptions& options, EventTable& table) {
+    table.is_sparse = options.input_format == EventFormat::Sparse;
+    if (table.is_sparse) {
+        return loadSparseEvents(options.input_path, table.sparse);
+    }
+    return loadEvents(options.input_path, options.input_format, table.dense);
+}
+
+// ONNX session created from in-memory model bytes and run on whole batches
+class BulkSession {
+private:
+    Ort::Env env;
+    Ort::Session session;
+    std::vector<std::string> input_node_names;
+    std::vector<std::string> output_node_names;
+    std::vector<const char*> input_names;
+    std::vector<const char*> output_names;
+    bool profiling;
+
+public:
+    BulkSession(const ModelBytes& model, int threads)
+        : env(ORT_LOGGING_LEVEL_WARNING, "PSNNBulk"), session(nullptr), profiling(false) {
+        Ort::SessionOptions session_options;
+        session_options.SetIntraOpNumThreads(threads);
+        session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+        // Both only apply to ORT-format (.ort) models: they are parsed in place and their initializers
+        // stay in the shared mapping. An .onnx model is deserialised, weights included, by every worker
+        session_options.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+        session_options.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+        if (tracingEnabled() && traceOptions().ort_profiling) {
+            session_options.EnableProfiling(traceOptions().ort_profile_prefix.c_str());
+            profiling = true;
+        }
+
+        session = Ort::Session(env, model.data, model.size, session_options);
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        for (size_t i = 0; i < session.GetInputCount(); i++) {
+            input_node_names.push_back(session.GetInputNameAllocated(i, allocator).get());
+        }
+        for (size_t i = 0; i < session.GetOutputCount(); i++) {
+            output_node_names.push_back(session.GetOutputNameAllocated(i, allocator).get());
+        }
+        for (const auto& name : input_node_names) input_names.push_back(name.c_str());
+        for (const auto& name : output_node_names) output_names.push_back(name.c_str());
+    }
+
+    // Stop ORT's profiler and report where it wrote its events; false if it was not running
+    bool endProfiling(OrtProfile& profile) {
+        if (!profiling) {
+            return false;
+        }
+        profiling = false;
+        Ort::AllocatorWithDefaultOptions allocator;
+        auto path = session.EndProfilingAllocated(allocator);
+        profile.path = path.get();
+        profile.start_ns = session.GetProfilingStartTimeNs();
+        return true;
+    }
+
+    // Run n_rows standardised rows; writes NUM_CLASSES probabilities per row
+    void run(const float* inputs, size_t n_rows, float* probs) {
+        Ort::Value input_tensor(nullptr);
+        std::vector<int64_t> input_shape = {static_cast<int64_t>(n_rows), static_cast<int64_t>(KEPT_FEATURE_COUNT)};
+        {
+            TraceSpan span("tensor build");
+            Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+            input_tensor = Ort::Value::CreateTensor<float>(
+                memory_info, const_cast<float*>(inputs), n_rows * KEPT_FEATURE_COUNT,
+                input_shape.data(), input_shape.size());
+        }
+
+        std::vector<Ort::Value> output_tensors;
+        {
+            TraceSpan span("Session::Run");
+            output_tensors = session.Run(
+                Ort::RunOptions{nullptr},
+                input_names.data(), &input_tensor, 1,
+                output_names.data(), output_names.size());
+        }
+
+        TraceSpan span("extract");
+        const float* output_data = output_tensors[0].GetTensorMutableData<float>();
+        std::memcpy(probs, output_data, n_rows * NUM_CLASSES * sizeof(float));
+    }
+};
+
+// A session plus scratch buffers, reused for every chunk a process scores
+class BulkScorer {
+private:
+    BulkSession session;
+    size_t batch_rows;
+    std::vector<float> inputs;
+    std::vector<float> probs;
+
+public:
+    BulkScorer(const ModelBytes& model, int threads, size_t batch_rows)
+        : session(model, threads), batch_rows(batch_rows),
+          inputs(batch_rows * KEPT_FEATURE_COUNT), probs(batch_rows * NUM_CLASSES) {}
+
+    // Score rows [begin, end) of a raw event table into results[0, end - begin), summary
+    // and/or drift (any may be null)
+    void score(const EventTable& table, size_t begin, size_t end, BulkResult* results, RunSummary* summary,
+               DriftStats* drift) {
+        uint32_t zeroed[KEPT_FEATURE_COUNT];
+        for (size_t first = begin; first < end; first += batch_rows) {
+            size_t n = std::min(batch_rows, end - first);
+            TraceRequest request;
+            {
+                TraceSpan span("standardise");
+                std::fill(zeroed, zeroed + KEPT_FEATURE_COUNT, 0u);
+                for (size_t r = 0; r < n; r++) {
+                    table.standardise(first + r, inputs.data() + r * KEPT_FEATURE_COUNT, drift ? zeroed : nullptr);
+                }
+                if (drift) {
+                    addDriftRows(*drift, inputs.data(), n, zeroed);
+                }
+            }
+
+            session.run(inputs.data(), n, probs.data());
+
+            TraceSpan span("extract");
+            if (summary) {
+                for (size_t r = 0; r < n; r++) {
+                    addToSummary(*summary, probs.data() + r * NUM_CLASSES);
+                }
+            }
+            if (!results) {
+                continue;
+            }
+            for (size_t r = 0; r < n; r++) {
+                BulkResult& res = results[first - begin + r];
+                const float* p = probs.data() + r * NUM_CLASSES;
+                res.predicted_class = 0;
+                for (size_t c = 0; c < NUM_CLASSES; c++) {
+                    res.class_probabilities[c] = p[c];
+                    if (p[c] > p[res.predicted_class]) {
+                        res.predicted_class = static_cast<int32_t>(c);
+                    }
+                }
+            }
+        }
+    }
+
+    // Append this process's spans and ORT profile to trace_events
+    void collectTrace(std::vector<std::string>& trace_events) {
+        std::vector<OrtProfile> ort_profiles;
+        OrtProfile profile;
+        if (session.endProfiling(profile)) {
+            ort_profiles.push_back(profile);
+        }
+        collectTraceEvents(ort_profiles, trace_events);
+    }
+};
+
+static const char CHECKPOINT_MAGIC[8] = {'P', 'S', 'N', 'N', 'C', 'K', 'P', '2'};
+
+// Progress of a bulk run, rewritten next to the output after every chunk. The output
+// file holds exactly the results of the first rows_done events in its first output_bytes.
+struct BulkCheckpoint {
+    char magic[8];
+    uint64_t input_bytes;     // Size of the input file, to catch a resume against other data
+    uint64_t n_rows;
+    uint64_t chunk_rows;
+    uint32_t write_events;
+    uint32_t has_summary;
+    uint32_t has_drift;
+    uint32_t has_store;       // The first rows_done results are in the store's .part file
+    uint64_t rows_done;
+    uint64_t output_bytes;
+    RunSummary summary;       // Summary of the first rows_done events
+    DriftStats drift;         // Input drift of the first rows_done events
+};
+
+static std::string checkpointPath(const BulkOptions& options) {
+    if (options.write_events) {
+        return options.output_path + ".ckpt";
+    }
+    return (options.summary_path.empty() ? options.store_path : options.summary_path) + ".ckpt";
+}
+
+// Per-event results are kept for the output lines and for the result store
+static bool keepResults(const BulkOptions& options) {
+    return options.write_events || !options.store_path.empty();
+}
+
+// Results of the committed chunks, in input order, until the store is written
+static std::string storePartPath(const BulkOptions& options) {
+    return options.store_path + ".part";
+}
+
+static uint64_t fileBytes(const std::string& path) {
+    std::error_code ec;
+    uint64_t bytes = std::filesystem::file_size(path, ec);
+    return ec ? 0 : bytes;
+}
+
+// Push a stream's buffered writes to disk so a later checkpoint never claims more than survives a crash
+static bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Write the checkpoint atomically (temp file + rename)
+static int writeCheckpoint(const std::string& path, const BulkCheckpoint& checkpoint) {
+    std::string tmp_path = path + ".tmp";
+    std::FILE* file = std::fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open " << tmp_path << " for writing." << std::endl;
+        return 1;
+    }
+    bool ok = std::fwrite(&checkpoint, sizeof(checkpoint), 1, file) == 1 && syncFile(file);
+    ok = std::fclose(file) == 0 && ok;
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Could not write checkpoint " << path << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Read a checkpoint; returns false if there is none or it is unreadable
+static bool readCheckpoint(const std::string& path, BulkCheckpoint& checkpoint) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&checkpoint), sizeof(checkpoint))) {
+        return false;
+    }
+    return std::memcmp(checkpoint.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0;
+}
+
+/**
+ * Takes completed chunks in input order: appends their result lines to the
+ * output, adds them to the run summary, syncs the output and then records the
+ * new prefix in the checkpoint. With resume, a matching checkpoint is loaded
+ * and the output is cut back to the length it records, dropping any lines of
+ * a chunk that was being written when the previous run stopped. Drift
+ * statistics are merged the same way and checked after every chunk. Results
+ * for the result store are appended to its .part file, which is cut back the
+ * same way and turned into the store when the run finishes.
+ */
+class ChunkCommitter {
+private:
+    const BulkOptions& options;
+    std::string path;
+    std::unique_ptr<BulkCheckpoint> checkpoint;
+    std::FILE* output;
+    std::FILE* store_part;
+    std::vector<EventId> ids;  // One per input row, for the result store
+    std::vector<bool> drift_reported;
+    bool drifted;
+
+public:
+    explicit ChunkCommitter(const BulkOptions& options)
+        : options(options), path(checkpointPath(options)), checkpoint(new BulkCheckpoint), output(nullptr),
+          store_part(nullptr), drifted(false) {}
+
+    ~ChunkCommitter() {
+        if (output) std::fclose(output);
+        if (store_part) std::fclose(store_part);
+    }
+
+    ChunkCommitter(const ChunkCommitter&) = delete;
+    ChunkCommitter& operator=(const ChunkCommitter&) = delete;
+
+    // Load or start the checkpoint and open the output for appending
+    int open(size_t n_rows) {
+        BulkCheckpoint& cp = *checkpoint;
+        uint64_t input_bytes = fileBytes(options.input_path);
+        bool resumed = false;
+
+        if (!options.store_path.empty()) {
+            if (loadEventIds(options.ids_path, ids) != 0) {
+                return 1;
+            }
+            if (ids.size() != n_rows) {
+                std::cerr << "Error: " << options.ids_path << " has " << ids.size() << " event IDs for " << n_rows
+                          << " events." << std::endl;
+                return 1;
+            }
+        }
+
+        if (options.resume && readCheckpoint(path, cp)) {
+            bool same_summary = (cp.has_summary != 0) == !options.summary_path.empty() &&
+                                (!cp.has_summary || (cp.summary.n_thresholds == std::min(options.thresholds.size(), SUMMARY_MAX_THRESHOLDS) &&
+                                 std::equal(options.thresholds.begin(), options.thresholds.begin() + cp.summary.n_thresholds,
+                                            cp.summary.thresholds)));
+            if (cp.input_bytes != input_bytes || cp.n_rows != n_rows || cp.chunk_rows != options.chunk_rows ||
+                (cp.write_events != 0) != options.write_events || !same_summary ||
+                (cp.has_drift != 0) != !options.drift_path.empty() ||
+                (cp.has_store != 0) != !options.store_path.empty() || cp.rows_done > n_rows) {
+                std::cerr << "Error: " << path << " was written by a run with different input or options;"
+                          << " rerun without --resume to start over." << std::endl;
+                return 1;
+            }
+            if (options.write_events && fileBytes(options.output_path) < cp.output_bytes) {
+                std::cerr << "Error: " << options.output_path << " is shorter than " << path << " records." << std::endl;
+                return 1;
+            }
+            if (cp.has_store && fileBytes(storePartPath(options)) < cp.rows_done * sizeof(BulkResult)) {
+                std::cerr << "Error: " << storePartPath(options) << " is shorter than " << path << " records."
+                          << std::endl;
+                return 1;
+            }
+            resumed = true;
+            std::cout << "Resuming after " << cp.rows_done << " of " << n_rows << " events" << std::endl;
+        } else {
+            if (options.resume) {
+                std::cout << "No checkpoint at " << path << ", starting from the beginning" << std::endl;
+            }
+            std::memset(&cp, 0, sizeof(cp));
+            std::memcpy(cp.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+            cp.input_bytes = input_bytes;
+            cp.n_rows = n_rows;
+            cp.chunk_rows = options.chunk_rows;
+            cp.write_events = options.write_events ? 1 : 0;
+            cp.has_summary = options.summary_path.empty() ? 0 : 1;
+            cp.has_drift = options.drift_path.empty() ? 0 : 1;
+            cp.has_store = options.store_path.empty() ? 0 : 1;
+            initSummary(cp.summary, options.thresholds);
+            initDrift(cp.drift);
+        }
+
+        if (options.write_events) {
+            try {
+                if (resumed) {
+                    std::filesystem::resize_file(options.output_path, cp.output_bytes);
+                }
+            }
+            catch (const std::filesystem::filesystem_error& e) {
+                std::cerr << "Error: Could not truncate " << options.output_path << ": " << e.what() << std::endl;
+                return 1;
+            }
+            output = std::fopen(options.output_path.c_str(), resumed ? "ab" : "wb");
+            if (!output) {
+                std::cerr << "Error: Could not open " << options.output_path << " for writing." << std::endl;
+                return 1;
+            }
+            if (!resumed) {
+                static const char header[] = "Class 0,Class 1,Class 2,Predicted\n";
+                std::fwrite(header, 1, sizeof(header) - 1, output);
+                cp.output_bytes = sizeof(header) - 1;
+                if (!syncFile(output)) {
+                    std::cerr << "Error: Could not write " << options.output_path << std::endl;
+                    return 1;
+                }
+            }
+        }
+        if (cp.has_store) {
+            std::string part_path = storePartPath(options);
+            try {
+                if (resumed) {
+                    std::filesystem::resize_file(part_path, cp.rows_done * sizeof(BulkResult));
+                }
+            }
+            catch (const std::filesystem::filesystem_error& e) {
+                std::cerr << "Error: Could not truncate " << part_path << ": " << e.what() << std::endl;
+                return 1;
+            }
+            store_part = std::fopen(part_path.c_str(), resumed ? "ab" : "wb");
+            if (!store_part) {
+                std::cerr << "Error: Could not open " << part_path << " for writing." << std::endl;
+                return 1;
+            }
+        }
+        return resumed ? 0 : writeCheckpoint(path, cp);
+    }
+
+    // First row not yet committed; always at a chunk boundary
+    size_t rowsDone() const { return static_cast<size_t>(checkpoint->rows_done); }
+
+    const RunSummary& summary() const { return checkpoint->summary; }
+
+    const DriftStats& drift() const { return checkpoint->drift; }
+
+    // True once a commit stopped the run because of drift_abort
+    bool stoppedByDrift() const { return drifted; }
+
+    // Commit the next chunk: results (n_rows, or null if neither the output nor a store needs them) and its partial
+    // summary and drift (each may be null)
+    int commit(const BulkResult* results, size_t n_rows, const RunSummary* chunk_summary,
+               const DriftStats* chunk_drift) {
+        BulkCheckpoint& cp = *checkpoint;
+        if (output && results) {
+            char line[96];
+            for (size_t i = 0; i < n_rows; i++) {
+                const BulkResult& r = results[i];
+                int len = std::snprintf(line, sizeof(line), "%g,%g,%g,%d\n",
+                                        r.class_probabilities[0], r.class_probabilities[1],
+                                        r.class_probabilities[2], r.predicted_class);
+                std::fwrite(line, 1, len, output);
+                cp.output_bytes += len;
+            }
+            if (std::ferror(output) || !syncFile(output)) {
+                std::cerr << "Error: Could not write " << options.output_path << std::endl;
+                return 1;
+            }
+        }
+        if (store_part && results) {
+            if (std::fwrite(results, sizeof(BulkResult), n_rows, store_part) != n_rows || !syncFile(store_part)) {
+                std::cerr << "Error: Could not write " << storePartPath(options) << std::endl;
+                return 1;
+            }
+        }
+        if (cp.has_summary && chunk_summary) {
+            mergeSummary(cp.summary, *chunk_summary);
+        }
+        if (cp.has_drift && chunk_drift) {
+            mergeDrift(cp.drift, *chunk_drift);
+        }
+        cp.rows_done += n_rows;
+        if (writeCheckpoint(path, cp) != 0) {
+            return 1;
+        }
+
+        if (cp.has_drift && warnDrift(cp.drift, options.drift, drift_reported) > 0 && options.drift_abort) {
+            std::cerr << "Error: Stopping after " << cp.rows_done << " of " << cp.n_rows
+                      << " events because the inputs have drifted from the training data." << std::endl;
+            drifted = true;
+            return 1;
+        }
+        return 0;
+    }
+
+    // The run is complete: close the output, write the result store and remove the checkpoint
+    int finish() {
+        if (output) {
+            bool ok = std::fclose(output) == 0;
+            output = nullptr;
+            if (!ok) {
+                std::cerr << "Error: Could not write " << options.output_path << std::endl;
+                return 1;
+            }
+        }
+        if (store_part) {
+            bool ok = std::fclose(store_part) == 0;
+            store_part = nullptr;
+            if (!ok || writeStore() != 0) {
+                return 1;
+            }
+        }
+        std::remove(path.c_str());
+        return 0;
+    }
+
+private:
+    // Pair the results in the .part file with their IDs and write the store
+    int writeStore() {
+        std::string part_path = storePartPath(options);
+        std::ifstream in(part_path, std::ios::binary);
+        std::vector<StoredResult> records(ids.size());
+        BulkResult result;
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (!in.read(reinterpret_cast<char*>(&result), sizeof(result))) {
+                std::cerr << "Error: " << part_path << " holds fewer results than the run scored." << std::endl;
+                return 1;
+            }
+            records[i].id = ids[i];
+            std::memcpy(records[i].class_probabilities, result.class_probabilities, sizeof(result.class_probabilities));
+            records[i].predicted_class = result.predicted_class;
+        }
+        if (writeResultStore(options.store_path, records) != 0) {
+            return 1;
+        }
+        std::remove(part_path.c_str());
+        return 0;
+    }
+};
+
+#ifndef _WIN32
+// Parse a sysfs cpulist such as "0-3,8-11"
+static std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream ss(text);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (part.empty() || part == "\n") continue;
+        size_t dash = part.find('-');
+        int lo = std::atoi(part.c_str());
+        int hi = dash == std::string::npos ? lo : std::atoi(part.c_str() + dash + 1);
+        for (int c = lo; c <= hi; c++) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+// CPUs this process may run on
+static std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+    return cpus;
+}
+
+// Split the allowed CPUs into one group per worker. With numa, each NUMA node is
+// one group (split further if more workers than nodes were requested).
+static std::vector<std::vector<int>> cpuGroups(int workers, bool numa) {
+    std::vector<int> allowed = allowedCpus();
+    std::vector<std::vector<int>> groups;
+
+    if (numa) {
+        for (int node = 0; ; node++) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!in.is_open()) break;
+            std::string text;
+            std::getline(in, text);
+
+            std::vector<int> cpus;
+            for (int c : parseCpuList(text)) {
+                if (std::find(allowed.begin(), allowed.end(), c) != allowed.end()) cpus.push_back(c);
+            }
+            if (!cpus.empty()) groups.push_back(cpus);
+        }
+        if (groups.empty()) {
+            std::cerr << "Warning: No NUMA topology found, treating the host as one node." << std::endl;
+            groups.push_back(allowed);
+        }
+        if (workers <= static_cast<int>(groups.size())) {
+            return groups;
+        }
+
+        // Several workers per node: split each node's CPUs evenly
+        std::vector<std::vector<int>> split;
+        int per_node = (workers + static_cast<int>(groups.size()) - 1) / static_cast<int>(groups.size());
+        for (const auto& node_cpus : groups) {
+            int parts = std::min<int>(per_node, static_cast<int>(node_cpus.size()));
+            for (int p = 0; p < parts; p++) {
+                split.emplace_back(node_cpus.begin() + node_cpus.size() * p / parts,
+                                   node_cpus.begin() + node_cpus.size() * (p + 1) / parts);
+            }
+        }
+        return split;
+    }
+
+    int parts = std::max(1, std::min<int>(workers, static_cast<int>(allowed.size())));
+    for (int p = 0; p < parts; p++) {
+        groups.emplace_back(allowed.begin() + allowed.size() * p / parts,
+                            allowed.begin() + allowed.size() * (p + 1) / parts);
+    }
+    return groups;
+}
+
+static void pinToCpus(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) CPU_SET(c, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        std::cerr << "Warning: Could not pin worker " << getpid() << " to its CPU group." << std::endl;
+    }
+}
+
+// Per-worker trace events are staged here and merged by the parent
+static std::string tracePartPath(const BulkOptions& options, size_t worker) {
+    return options.trace_path + ".part" + std::to_string(worker);
+}
+
+// Chunk bookkeeping shared between the parent and forked workers; n_chunks
+// std::atomic<uint32_t> done flags follow it in the same mapping
+struct ChunkBoard {
+    std::atomic<uint64_t> next_chunk;  // Next chunk a worker will claim
+};
+
+// Fork one pinned worker per CPU group. Workers claim chunks in input order and score
+// them into shared results and per-chunk summaries; the parent commits each finished
+// chunk as soon as all chunks before it are done, so the checkpoint keeps up with the run.
+static int scoreSharded(const ModelBytes& model, const EventTable& table, size_t n_rows,
+                        const BulkOptions& options, ChunkCommitter& committer,
+                        std::vector<std::string>* trace_events) {
+    size_t chunk_rows = options.chunk_rows;
+    size_t start_row = committer.rowsDone();
+    size_t first_chunk = start_row / chunk_rows;
+    size_t n_chunks = (n_rows + chunk_rows - 1) / chunk_rows;
+    size_t remaining = n_chunks - first_chunk;
+
+    std::vector<std::vector<int>> groups = cpuGroups(options.workers, options.numa);
+    size_t n_workers = std::min(groups.size(), std::max<size_t>(1, remaining));
+
+    std::cout << "Scoring " << n_rows - start_row << " events with " << n_workers << " worker(s)" << std::endl;
+
+    // Board and done flags, results of the remaining rows and one summary and drift partial
+    // per remaining chunk
+    size_t board_bytes = sizeof(ChunkBoard) + n_chunks * sizeof(std::atomic<uint32_t>);
+    size_t results_bytes = keepResults(options) ? (n_rows - start_row) * sizeof(BulkResult) : 0;
+    size_t summary_bytes = options.summary_path.empty() ? 0 : remaining * sizeof(RunSummary);
+    size_t drift_bytes = options.drift_path.empty() ? 0 : remaining * sizeof(DriftStats);
+    size_t results_offset = (board_bytes + 7) / 8 * 8;
+    size_t bytes = results_offset + results_bytes + summary_bytes + drift_bytes;
+    void* shared = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        std::cerr << "Error: Could not map shared results: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    char* base = static_cast<char*>(shared);
+    ChunkBoard* board = new (base) ChunkBoard();
+    std::atomic<uint32_t>* done = reinterpret_cast<std::atomic<uint32_t>*>(board + 1);
+    for (size_t c = 0; c < n_chunks; c++) {
+        new (done + c) std::atomic<uint32_t>(0);
+    }
+    board->next_chunk.store(first_chunk);
+    BulkResult* results = results_bytes ? reinterpret_cast<BulkResult*>(base + results_offset) : nullptr;
+    RunSummary* summaries = summary_bytes ? reinterpret_cast<RunSummary*>(base + results_offset + results_bytes) : nullptr;
+    DriftStats* drifts = drift_bytes ? reinterpret_cast<DriftStats*>(base + results_offset + results_bytes + summary_bytes)
+                                     : nullptr;
+
+    std::vector<pid_t> pids;
+    for (size_t w = 0; w < n_workers; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "Error: fork failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (pid == 0) {
+            // Pin before the session allocates so first-touch places memory on the local node
+            pinToCpus(groups[w]);
+            clearTraceRecords();
+            int rc = 0;
+            try {
+                BulkScorer scorer(model, static_cast<int>(groups[w].size()), options.batch_rows);
+                uint64_t c;
+                while ((c = board->next_chunk.fetch_add(1)) < n_chunks) {
+                    size_t begin = c * chunk_rows;
+                    size_t end = std::min(n_rows, begin + chunk_rows);
+                    RunSummary* summary = summaries ? summaries + (c - first_chunk) : nullptr;
+                    DriftStats* drift = drifts ? drifts + (c - first_chunk) : nullptr;
+                    if (summary) {
+                        initSummary(*summary, options.thresholds);
+                    }
+                    if (drift) {
+                        initDrift(*drift);
+                    }
+                    scorer.score(table, begin, end, results ? results + (begin - start_row) : nullptr, summary, drift);
+                    done[c].store(1, std::memory_order_release);
+                }
+                if (!options.trace_path.empty()) {
+                    std::vector<std::string> worker_events;
+                    scorer.collectTrace(worker_events);
+                    rc = writeTraceEventLines(tracePartPath(options, w), worker_events);
+                }
+            }
+            catch (const Ort::Exception& e) {
+                std::cerr << "ONNX Runtime error: " << e.what() << std::endl;
+                rc = 1;
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                rc = 1;
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            _exit(rc);
+        }
+        pids.push_back(pid);
+    }
+
+    int failures = pids.size() == n_workers ? 0 : 1;
+    size_t next_commit = first_chunk;
+    auto commitReady = [&]() {
+        while (next_commit < n_chunks && done[next_commit].load(std::memory_order_acquire)) {
+            size_t begin = next_commit * chunk_rows;
+            size_t end = std::min(n_rows, begin + chunk_rows);
+            if (committer.commit(results ? results + (begin - start_row) : nullptr, end - begin,
+                                 summaries ? summaries + (next_commit - first_chunk) : nullptr,
+                                 drifts ? drifts + (next_commit - first_chunk) : nullptr) != 0) {
+                return 1;
+            }
+            next_commit++;
+        }
+        return 0;
+    };
+
+    std::vector<pid_t> running = pids;
+    bool stopped = false;
+    while (!running.empty()) {
+        if (!stopped && commitReady() != 0) {
+            // Without a place to record progress (or after drift_abort) there is no point in scoring further
+            for (pid_t pid : running) kill(pid, SIGKILL);
+            failures++;
+            stopped = true;
+        }
+        for (size_t i = 0; i < running.size(); ) {
+            int status = 0;
+            pid_t pid = waitpid(running[i], &status, WNOHANG);
+            if (pid == 0) {
+                i++;
+                continue;
+            }
+            if (!stopped && (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+                std::cerr << "Error: Worker " << running[i] << " failed." << std::endl;
+                failures++;
+            }
+            running.erase(running.begin() + i);
+        }
+        if (!running.empty()) {
+            usleep(20000);
+        }
+    }
+    if (failures == 0 && commitReady() != 0) {
+        failures++;
+    }
+
+    if (!options.trace_path.empty() && trace_events) {
+        for (size_t w = 0; w < pids.size(); w++) {
+            readTraceEventLines(tracePartPath(options, w), *trace_events);
+            std::remove(tracePartPath(options, w).c_str());
+        }
+    }
+
+    munmap(shared, bytes);
+    if (failures == 0 && next_commit != n_chunks) {
+        failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
+#endif
+
+// Score the remaining chunks in this process, committing each as it completes
+static int scoreLocal(const ModelBytes& model, const EventTable& table, size_t n_rows,
+                      const BulkOptions& options, ChunkCommitter& committer,
+                      std::vector<std::string>* trace_events) {
+    try {
+        BulkScorer scorer(model, 1, options.batch_rows);
+        std::vector<BulkResult> results(keepResults(options) ? std::min(n_rows, options.chunk_rows) : 0);
+        std::unique_ptr<RunSummary> chunk_summary;
+        if (!options.summary_path.empty()) {
+            chunk_summary.reset(new RunSummary);
+        }
+        std::unique_ptr<DriftStats> chunk_drift;
+        if (!options.drift_path.empty()) {
+            chunk_drift.reset(new DriftStats);
+        }
+
+        for (size_t begin = committer.rowsDone(); begin < n_rows; begin += options.chunk_rows) {
+            size_t end = std::min(n_rows, begin + options.chunk_rows);
+            if (chunk_summary) {
+                initSummary(*chunk_summary, options.thresholds);
+            }
+            if (chunk_drift) {
+                initDrift(*chunk_drift);
+            }
+            scorer.score(table, begin, end, keepResults(options) ? results.data() : nullptr, chunk_summary.get(),
+                         chunk_drift.get());
+            if (committer.commit(keepResults(options) ? results.data() : nullptr, end - begin,
+                                 chunk_summary.get(), chunk_drift.get()) != 0) {
+                return 1;
+            }
+        }
+
+        if (trace_events && tracingEnabled()) {
+            scorer.collectTrace(*trace_events);
+        }
+        return 0;
+    }
+    catch (const Ort::Exception& e) {
+        std::cerr << "ONNX Runtime error: " << e.what() << std::endl;
+        return 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runBulk(const BulkOptions& options) {
+    std::vector<std::string> trace_events;
+    std::vector<std::string>* trace = nullptr;
+    if (!options.trace_path.empty()) {
+        TraceOptions trace_options;
+        trace_options.sample_rate = options.trace_sample_rate;
+        trace_options.ort_profiling = options.trace_ort;
+        enableTracing(trace_options);
+        trace = &trace_events;
+    }
+
+    EventTable table;
+    {
+        TraceRequest request(true);
+        TraceSpan span("parse");
+        if (loadTable(options, table) != 0) {
+            return 1;
+        }
+    }
+    size_t n_rows = table.rows();
+
+    ModelBytes model;
+    if (mapModel(options.model_path, model) != 0) {
+        return 1;
+    }
+
+    ChunkCommitter committer(options);
+    if (committer.open(n_rows) != 0) {
+        unmapModel(model);
+        return 1;
+    }
+
+    int rc = 0;
+    bool sharded = options.workers > 1 || options.numa;
+#ifndef _WIN32
+    if (sharded) {
+        // The parent's own spans (parse) are collected before the workers' are appended
+        if (trace) {
+            collectTraceEvents({}, *trace);
+        }
+        rc = scoreSharded(model, table, n_rows, options, committer, trace);
+    }
+#else
+    if (sharded) {
+        std::cerr << "Warning: --workers/--numa need fork(); scoring in a single process." << std::endl;
+        sharded = false;
+    }
+#endif
+
+    if (!sharded) {
+        rc = scoreLocal(model, table, n_rows, options, committer, trace);
+    }
+
+    // The drift report also explains a run stopped by drift_abort
+    if ((rc == 0 || committer.stoppedByDrift()) && !options.drift_path.empty() &&
+        writeDriftReport(options.drift_path, committer.drift(), options.drift) != 0) {
+        rc = 1;
+    }
+    if (rc == 0 && !options.summary_path.empty()) {
+        rc = writeSummary(options.summary_path, committer.summary());
+    }
+    if (rc == 0) {
+        rc = committer.finish();
+    }
+    if (rc == 0 && trace) {
+        rc = writeChromeTrace(options.trace_path, *trace);
+    }
+    unmapModel(model);
+    return rc;
+}
+
+// Set by SIGINT / SIGTERM to stop runShmServer
+static std::atomic<bool> g_stop_serving{false};
+
+static void stopServing(int) {
+    g_stop_serving.store(true);
+}
+
+int runShmServer(const ServeOptions& options) {
+    ModelBytes model;
+    if (mapModel(options.model_path, model) != 0) {
+        return 1;
+    }
+
+    int rc = 0;
+    try {
+        BulkSession session(model, options.threads);
+        ShmRing ring;
+        if (ring.create(options.shm_name, options.slots) != 0) {
+            unmapModel(model);
+            return 1;
+        }
+
+        std::signal(SIGINT, stopServing);
+        std::signal(SIGTERM, stopServing);
+        if (!options.drift_path.empty()) {
+            enableDriftMonitor(options.drift);
+        }
+        std::cout << "Serving " << options.model_path << " on " << options.shm_name << std::endl;
+
+        rc = ring.serve(options.batch_rows, [&session](const float* inputs, size_t n_rows, float* probs) {
+            try {
+                session.run(inputs, n_rows, probs);
+                return true;
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Inference error: " << e.what() << std::endl;
+                return false;
+            }
+        }, g_stop_serving);
+        ring.close();
+
+        if (!options.drift_path.empty()) {
+            std::unique_ptr<DriftStats> drift(new DriftStats);
+            driftSnapshot(*drift);
+            if (writeDriftReport(options.drift_path, *drift, options.drift) != 0) {
+                rc = 1;
+            }
+        }
+    }
+    catch (const Ort::Exception& e) {
+        std::cerr << "ONNX Runtime error: " << e.what() << std::endl;
+        rc = 1;
+    }
+    unmapModel(model);
+    return rc;
+}
@@ -0,0 +1,96 @@
+// PSNN_bulk.h - Bulk scoring of event files
+#ifndef PSNN_BULK_H
+#define PSNN_BULK_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "PSNN_io.h"
+#include "PSNN_drift.h"
+
+// Options for a bulk scoring run
+struct BulkOptions {
+    std::string model_path = "RDP_TripleNN.onnx";
+    std::string input_path;
+    std::string output_path = "prediction_result.csv";
+    EventFormat input_format = EventFormat::Csv;
+    int workers = 1;          // Worker processes; each gets its own row range
+    bool numa = false;        // One worker per NUMA node, pinned to that node's CPUs
+    size_t batch_rows = 1024; // Rows per Session::Run call
+    bool write_events = true; // Write one result line per event to output_path
+    std::string summary_path; // If set, write aggregate statistics (see PSNN_summary.h) here
+    std::vector<double> thresholds{0.5, 0.9, 0.99};  // Summary probability thresholds
+    std::string trace_path;           // If set, write a Chrome trace of the run's stages here
+    double trace_sample_rate = 1.0;   // Fraction of batches traced
+    bool trace_ort = false;           // Merge ORT's own profiler events into the trace
+    size_t chunk_rows = 65536;        // Rows per checkpointed chunk
+    bool resume = false;              // Continue from the checkpoint of an interrupted run
+    std::string drift_path;           // If set, monitor input drift (see PSNN_drift.h) and report it here
+    DriftOptions drift;               // Drift thresholds
+    bool drift_abort = false;         // Stop the run once any feature is flagged as drifted
+    std::string store_path;           // If set, write a result store (see PSNN_store.h) here
+    std::string ids_path;             // Event IDs for the store, one line per input event
+};
+
+// Result of scoring one event
+struct BulkResult {
+    float class_probabilities[3];
+    int32_t predicted_class;
+};
+
+// Options for a resident shared-memory server (PSNN --serve-shm)
+struct ServeOptions {
+    std::string model_path = "RDP_TripleNN.onnx";
+    std::string shm_name = "/psnn";   // Shared memory object clients connect to
+    uint32_t slots = 256;             // Ring slots (in-flight requests), rounded up to a power of two, at least 4
+    size_t batch_rows = 64;           // Most waiting requests evaluated in one Session::Run
+    int threads = 1;                  // Intra-op threads of the session
+    std::string drift_path;           // If set, monitor input drift and write a report here on shutdown
+    DriftOptions drift;               // Drift thresholds
+};
+
+/**
+ * Score every event of an input file and write one result line per event,
+ * in input order, to the output file, and/or a summary of the whole run.
+ *
+ * Events are scored in chunks of chunk_rows. As each chunk is finished, in
+ * input order, its lines are appended and synced to the output, and a
+ * checkpoint next to it (output_path + ".ckpt", or summary_path + ".ckpt"
+ * without write_events) is replaced atomically. The checkpoint records the
+ * rows done, the output length and the summary so far. With resume, a run
+ * starts after the last checkpointed chunk and cuts the output back to the
+ * recorded length first. The checkpoint is removed when the run completes.
+ *
+ * With drift_path, the standardised inputs of each chunk are also checked
+ * against the training statistics as the chunk is committed; drifted features
+ * are reported on stderr as soon as they are flagged (and stop the run with
+ * drift_abort), and a per-feature report is written at the end.
+ *
+ * With store_path, each committed chunk's results are also appended to
+ * store_path + ".part", and once the run completes they are written with the
+ * IDs from ids_path as a result store indexed by event ID.
+ *
+ * With workers > 1 (or numa) the chunks are scored by forked worker processes
+ * pinned to disjoint CPU groups, each claiming the next chunk in input order. All workers
+ * load the model from one shared read-only mapping of the model file. Only an ORT-format
+ * (.ort) model is used in place, with its initializers left in the mapping; an .onnx model
+ * is deserialised by each worker into its own copy of the weights.
+ *
+ * @param options Run configuration
+ * @return 0 on success, non-zero on failure
+ */
+int runBulk(const BulkOptions& options);
+
+/**
+ * Serve predictions over a shared-memory ring (see PSNN_shm.h) until SIGINT or
+ * SIGTERM. With drift_path, every request is recorded with the process-wide
+ * drift monitor and the report is written on shutdown. Linux only.
+ *
+ * @param options Server configuration
+ * @return 0 on a clean shutdown, non-zero on failure
+ */
+int runShmServer(const ServeOptions& options);
+
+#endif // PSNN_BULK_H
@@ -1,96 +1,272 @@
 // PSNN.cpp - Windows DLL version
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <climits>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
 #include <onnxruntime_cxx_api.h>
 
-// Windows-specific DLL export macros
 #ifdef _WIN32
-    #ifdef PSNN_EXPORTS
-        #define PSNN_API __declspec(dllexport)
-    #else
-        #define PSNN_API __declspec(dllimport)
-    #endif
+#include <windows.h>
+#include <psapi.h>
 #else
-    #define PSNN_API
+#include <unistd.h>
+#define _strdup strdup
 #endif
 
-// Structure for returning predictions
-struct PredictionResult {
-    float class_probabilities[3];  // Fixed size for 3 classes
-    int predicted_class;
-    float confidence;
-};
+#include "PSNN_dll.h"
+#include "PSNN_features.h"
+#include "PSNN_pool.h"
+#include "PSNN_summary.h"
+#include "PSNN_trace.h"
+#include "PSNN_shm.h"
+#include "PSNN_service.h"
+#include "PSNN_drift.h"
+#include "PSNN_latency.h"
+#include "PSNN_record.h"
+#include "PSNN_store.h"
+
+// The C API has the plan's dimensions built in; a plan for another model needs PSNN_dll.h to match
+static_assert(sizeof(PredictionResult::class_probabilities) == NUM_CLASSES * sizeof(float),
+              "PredictionResult must hold NUM_CLASSES probabilities");
+
+// Lookups hand out records of the mapped store as PSNN_StoredResult, so the two must have one layout
+static_assert(sizeof(PSNN_EventId) == sizeof(EventId) && sizeof(PSNN_StoredResult) == sizeof(StoredResult) &&
+              offsetof(PSNN_StoredResult, class_probabilities) == offsetof(StoredResult, class_probabilities) &&
+              offsetof(PSNN_StoredResult, predicted_class) == offsetof(StoredResult, predicted_class),
+              "PSNN_StoredResult must have the layout of StoredResult");
+
+// Current resident set size of this process in bytes, or 0 if unavailable
+static size_t residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident) {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+    return 0;
+#endif
+}
+
+// Rows per PSNN_PredictBulk tile: raw rows, standardised rows and the network's
+// activations should stay in one core's L2 cache
+static size_t bulkTileRows() {
+    size_t l2_bytes = 0;
+#if !defined(_WIN32) && defined(_SC_LEVEL2_CACHE_SIZE)
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 > 0) l2_bytes = static_cast<size_t>(l2);
+#endif
+    if (l2_bytes == 0) l2_bytes = 256 * 1024;
+
+    // Raw doubles + standardised floats + two 96-wide activation buffers + outputs
+    size_t bytes_per_row = FEATURE_COUNT * sizeof(double) + 3 * KEPT_FEATURE_COUNT * sizeof(float) +
+                           NUM_CLASSES * sizeof(float);
+    return std::min<size_t>(1024, std::max<size_t>(16, l2_bytes / 2 / bytes_per_row));
+}
 
-// Static vectors to hold standardisation parameters
-static const std::vector<std::string> DROP_NAMES{
-    "SRCompatF(A)1","SRCompatF(A)2","SRCompatF(A)3",
-    "SRCompatS(A)1","SRCompatS(A)2", "SRCompatS(A)3",
-    "RCompatXF(A)1","RCompatXF(A)2","RCompatXF(A)3",
-    "RCompatXS(A)1", "RCompatXS(A)2","RCompatXS(A)3",
-    "SetTot(1:A)1","SetTot(1:A)2","SetTot(1:A)3", 
-    "Consensus(A:0)1", "Consensus(A:0)2","Consensus(A:0)3", 
-    "Consensus(A:1)1", "Consensus(A:1)2", "Consensus(A:1)3",
-    "Consensus(A:2)1", "Consensus(A:2)2", "Consensus(A:2)3"
+// ORT allocator over a LockedPool, registered on the shared Env for the low-latency session that owns it
+struct PoolAllocator : OrtAllocator {
+    // Value-initialise the C struct, so hooks newer ORT versions look for (GetStats,
+    // AllocOnStream, ...) are null rather than garbage once `version` is set
+    PoolAllocator() : OrtAllocator() {}
+    
+    LockedPool pool;
+    Ort::MemoryInfo info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
+    std::atomic<bool> warmed_up{false};
+    std::atomic<uint64_t> fresh_after_warmup{0};  // Allocations since warm-up that were not reused blocks
 };
 
-static const std::vector<double> STD_DEV{
-    77.81935754, 78.61500891, 78.49932003, 0.33135391, 0.3302249,
-    0.33013326,  0.47501296,  0.45518937,  0.45380344,  0.43516053,
-    0.41983258, 0.42051523, 0.42452919, 0.40729272, 0.40618444,
-    0.42237544, 0.40565562, 0.40395664, 9.18215223, 8.87685838,
-    8.79940741, 0.29372744, 0.29004331, 0.28246039, 0.45595758,
-    0.44363619, 0.44087034, 0.27690231, 0.27243035, 0.27253431,
-    2.30955365, 2.26208653, 2.25805451, 0.29305205, 0.29300839,
-    0.29317703, 2.62412539, 2.66208001, 2.75144994, 0.23280591,
-    0.23614036, 0.23754669, 0.71210972, 0.73173777, 0.76329215,
-    0.10588893, 0.10604115, 0.1073419, 2.5910722, 2.63099812,
-    2.71640149, 0.22258118, 0.22258118, 0.22258118, 0.7824096,
-    0.81190509, 0.85185175, 0.09563661, 0.09563661, 0.09563661,
-    0.98819725, 1.04309565, 1.06479416, 1.00704312, 1.05179805,
-    1.07383432, 9.91944706, 9.84952037, 9.67515909, 1.59625999,
-    1.606194, 1.695653, 0.79266336, 0.82650908, 0.82976458,
-    0.22446628, 0.22453972, 0.22425348, 0.12584292, 0.12653409,
-    0.12659368, 56.66741131, 56.56714733, 56.6054163, 5.2931978,
-    5.51612525, 5.7820158, 47.38165939, 47.11818704, 47.63537705,
-    47.81972043, 47.4848627, 47.60851212,  0.21678955,  0.21445225,0.21430079
+static void* poolAlloc(OrtAllocator* self, size_t size) {
+    PoolAllocator* allocator = static_cast<PoolAllocator*>(self);
+    bool fresh = false;
+    void* p = allocator->pool.allocate(size, fresh);
+    if (fresh && allocator->warmed_up.load(std::memory_order_relaxed) &&
+        allocator->fresh_after_warmup.fetch_add(1, std::memory_order_relaxed) == 0) {
+        std::cerr << "Warning: ORT needed " << size << " bytes of new memory after warm-up." << std::endl;
+    }
+    return p;
+}
+
+static void poolFree(OrtAllocator* self, void* p) {
+    static_cast<PoolAllocator*>(self)->pool.release(p);
+}
+
+static const OrtMemoryInfo* poolInfo(const OrtAllocator* self) {
+    return static_cast<const PoolAllocator*>(self)->info;
+}
+
+// ORT state shared by every session in the process: one Env (and its thread
+// pools and logger), on which a tuned CPU arena or a session's low-latency pool
+// is registered
+struct SharedOrtState {
+    Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "ONNXModelInference"};
+    bool env_allocator_registered = false;
+    std::mutex mutex;
 };
 
-static const std::vector<double> MEANS{
-    93.64829657377209,94.9787838666968,94.9850292246585,0.1652282657021991,0.13167896018342107,
-    0.1261814410178577,0.34391448961798043,0.29311202247553847,0.290089450059741,0.4035286001872961,0.4692451581360804,
-    0.4790747803145283,0.34072728498078597,0.39561142345077027,0.4007465964413731,0.3378896775276908,0.3926582591791263,
-    0.39667262815254944,8.534188397590984,8.138416175767754,8.035000038001742,0.14400886621241968,0.13566300113023544,0.1323365148060839,
-    0.29481060483740756,0.2693770788258469,0.2641327865146769,0.49313046145897244,0.45780350050053287,0.4528006135563666,1.9242273064875508,
-    1.8578602447766979,1.8517204830949072,0.41068983543772397,0.38140402331514195,0.3787053476927051,2.291025930829593,2.5652985436109406,
-    2.6910582232699327,0.018529402266929312,0.019362547227693996,0.01950463396518875,0.0891335938256854,0.09324119223689734,0.09845319210772759,
-    0.002434850001614622,0.0024413084896825654,0.0024736009300222817,2.297264830303226,2.5751089869861468,2.704898763199535,0.01568766751703426,
-    0.01568766751703426,0.01568766751703426,0.11023347434365614,0.11721509994510285,0.12358316918009495,0.0023056802402557563,0.0023056802402557563,
-    0.0023056802402557563,0.2794264862595666,0.30316788839732617,0.31430878031452836,0.29001840669099366,0.31255853004811573,0.3237575483579294,
-    7.34176035643104,7.0250873698194845,6.9248489843833765,1.1292924726321567,1.2199631866180127,1.3192043142700294,1.0061291051764782,0.9959505279813996,
-    0.9979203668421223,0.3967839035747731,0.3919100010979429,0.39125673433009334,0.18867358949849838,0.1918002263700068,0.1927855593373591,-11.044021054671102,
-    -13.168644040430136,-13.399354151193206,3.154015564956244,3.225704782510414,3.483837633609972,61.81170923886718,60.48893338069558,60.484057222204285,
-    60.04446023185972,58.992721283947425,58.86758161914296,0.528549646892492,0.5111502837005976,0.5075989531249846
+static SharedOrtState& sharedOrtState() {
+    static SharedOrtState state;
+    return state;
+}
+
+// Deleter for a session's low-latency pool: takes it off the shared Env, then unmaps it.
+// If ORT will not let go of it, the pool is leaked rather than unmapped under ORT
+struct PoolRelease {
+    void operator()(PoolAllocator* allocator) const {
+        SharedOrtState& shared = sharedOrtState();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        try {
+            shared.env.UnregisterAllocator(allocator->info);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Warning: Could not release the low-latency pool: " << e.what() << std::endl;
+            return;
+        }
+        shared.env_allocator_registered = false;
+        delete allocator;
+    }
 };
 
+// Number of live sessions, reported by PSNN_GetMemoryStats
+static std::atomic<size_t> g_session_count{0};
+
+// Sessions created so far; numbers each session for t_pinned_session
+static std::atomic<uint64_t> g_session_serial{0};
+
+// Session the calling thread was last pinned for, 0 if none
+static thread_local uint64_t t_pinned_session = 0;
+
 // Internal class to handle ONNX session
 class ONNXInference {
 private:
-    Ort::Env env;
     Ort::Session* session;
     Ort::AllocatorWithDefaultOptions allocator;
+    Ort::RunOptions run_options;
     std::vector<const char*> input_names;
     std::vector<const char*> output_names;
+    size_t init_resident_delta;   // Process RSS growth across construction, not this session alone
+    std::unique_ptr<WorkStealingPool> bulk_pool;
+    std::mutex bulk_pool_mutex;
+    bool profiling;
+    bool low_latency;
+    std::unique_ptr<PoolAllocator, PoolRelease> pool;  // Low-latency pool, registered on the shared Env while the session lives
+    uint64_t serial;
+    int pin_request;              // PSNN_InitOptions::pin_cpu
+    bool pin_callers;             // PSNN_InitOptions::pin_callers
+    int pinned_cpu;               // CPU the initialising thread was pinned to, -1 if none
+    std::atomic<int> pinned_threads;
+    bool lock_process;            // PSNN_InitOptions::lock_process_memory
+    bool process_locked;
+    std::atomic<bool> counting_faults;   // Set once warm-up is over
+    std::atomic<uint64_t> call_faults;   // Page faults callers took inside single-event calls since then
     
 public:
-    ONNXInference(const char* model_path) : env(ORT_LOGGING_LEVEL_WARNING, "ONNXModelInference") {
+    // init_cpu: CPU the caller has pinned the initialising thread to, -1 if none
+    ONNXInference(const char* model_path, const PSNN_InitOptions& options, int init_cpu)
+        : session(nullptr), init_resident_delta(0), profiling(false), low_latency(options.low_latency != 0),
+          serial(++g_session_serial), pin_request(options.pin_cpu),
+          pin_callers(options.low_latency != 0 && options.pin_callers != 0), pinned_cpu(init_cpu), pinned_threads(0),
+          lock_process(options.low_latency != 0 && options.lock_process_memory != 0), process_locked(false),
+          counting_faults(false), call_faults(0) {
+        SharedOrtState& shared = sharedOrtState();
+        size_t resident_before = residentBytes();
+        
+        // The initialising thread stays pinned only if callers are pinned too
+        if (pin_callers && pin_request != PSNN_PIN_NONE) {
+            if (pinned_cpu >= 0) {
+                pinned_threads++;
+            }
+            t_pinned_session = serial;
+        }
+        // Process-wide and permanent, so only when the host has asked for it
+        if (lock_process) {
+            keepHeapResident();
+        }
+        
         Ort::SessionOptions session_options;
         session_options.SetIntraOpNumThreads(1);
         session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
         
-        session = new Ort::Session(env, model_path, session_options);
+        if (!options.enable_mem_pattern) {
+            session_options.DisableMemPattern();
+        }
+        
+        // ORT's profiler records every Run; it is merged into the trace by PSNN_WriteTrace
+        if (tracingEnabled() && traceOptions().ort_profiling) {
+            session_options.EnableProfiling(traceOptions().ort_profile_prefix.c_str());
+            profiling = true;
+        }
+        
+        // Arena tuning and sharing both go through an allocator registered on the shared Env;
+        // the first session that asks for it decides its configuration
+        bool custom_arena = options.arena_extend_strategy >= 0 || options.initial_chunk_size_bytes > 0;
+        if (low_latency) {
+            // The pool replaces ORT's arena for weights, activations and outputs alike
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            if (!shared.env_allocator_registered) {
+                std::unique_ptr<PoolAllocator> allocator(new PoolAllocator);
+                if (allocator->pool.reserve(options.locked_pool_bytes > 0 ? options.locked_pool_bytes : 16u << 20) != 0) {
+                    throw std::runtime_error("could not reserve the low-latency pool");
+                }
+                allocator->version = ORT_API_VERSION;
+                allocator->Alloc = poolAlloc;
+                allocator->Free = poolFree;
+                allocator->Info = poolInfo;
+                allocator->Reserve = poolAlloc;
+                shared.env.RegisterAllocator(allocator.get());
+                shared.env_allocator_registered = true;
+                pool.reset(allocator.release());
+            } else {
+                std::cerr << "Warning: Shared arena already configured; the low-latency pool is not used." << std::endl;
+            }
+            if (custom_arena) {
+                std::cerr << "Warning: Arena options are ignored in low-latency mode." << std::endl;
+            }
+            session_options.AddConfigEntry("session.use_env_allocators", "1");
+            session_options.AddConfigEntry("session.use_device_allocator_for_initializers", "1");
+            if (pool) {
+                pool->warmed_up.store(false);
+            }
+        } else if (custom_arena) {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            if (!shared.env_allocator_registered) {
+                Ort::ArenaCfg arena_cfg(0, options.arena_extend_strategy,
+                                        options.initial_chunk_size_bytes > 0 ? static_cast<int>(options.initial_chunk_size_bytes) : -1,
+                                        -1);
+                Ort::MemoryInfo cpu_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+                shared.env.CreateAndRegisterAllocator(cpu_info, arena_cfg);
+                shared.env_allocator_registered = true;
+            } else {
+                std::cerr << "Warning: Shared arena already configured; ignoring arena options." << std::endl;
+            }
+            session_options.AddConfigEntry("session.use_env_allocators", "1");
+        }
+        
+        session = new Ort::Session(shared.env, model_path, session_options);
+        
+        // Return freed arena chunks to the system at the end of every Run; never in
+        // low-latency mode, where they would have to be faulted in again
+        if (options.shrink_arena_after_run && low_latency) {
+            std::cerr << "Warning: Arena shrinking is disabled in low-latency mode." << std::endl;
+        } else if (options.shrink_arena_after_run) {
+            run_options.AddConfigEntry("memory.enable_memory_arena_shrinkage", "cpu:0");
+        }
         
         // Get input and output names
         size_t num_input_nodes = session->GetInputCount();
@@ -105,33 +281,172 @@ public:
             auto name = session->GetOutputNameAllocated(i, allocator);
             output_names.push_back(_strdup(name.get()));
         }
+        
+        // Include the arena's first growth in the delta
+        std::vector<float> warmup(KEPT_FEATURE_COUNT, 0.0f);
+        std::vector<float> probs;
+        runInference(warmup, probs);
+        
+        size_t resident_after = residentBytes();
+        init_resident_delta = resident_after > resident_before ? resident_after - resident_before : 0;
+        g_session_count++;
     }
     
     ~ONNXInference() {
+        bulk_pool.reset();
         delete session;
         for (auto& name : input_names) free((void*)name);
         for (auto& name : output_names) free((void*)name);
+        g_session_count--;
+    }
+    
+    // Growth of the process's resident set while this session was created and run once
+    size_t initResidentDelta() const {
+        return init_resident_delta;
+    }
+    
+    bool lowLatency() const {
+        return low_latency;
+    }
+    
+    // With pin_callers, pin the calling thread the first time it makes a single-event call;
+    // PSNN_Predict runs on whichever thread calls it, not necessarily the initialising one
+    void pinCallingThread() {
+        if (!pin_callers || pin_request == PSNN_PIN_NONE || t_pinned_session == serial) {
+            return;
+        }
+        t_pinned_session = serial;
+        if (pinCurrentThread(pin_request) >= 0) {
+            pinned_threads++;
+        }
+    }
+    
+    // Lock what warm-up mapped and start counting page faults and new allocations
+    void finishWarmup() {
+        if (lock_process) {
+            process_locked = lockProcessMemory();
+            if (!process_locked) {
+                std::cerr << "Warning: Could not lock the process's memory after warm-up." << std::endl;
+            }
+        }
+        if (pool) {
+            pool->fresh_after_warmup.store(0);
+            pool->warmed_up.store(true);
+        }
+        call_faults.store(0);
+        counting_faults.store(true);
+    }
+    
+    bool countingFaults() const {
+        return counting_faults.load(std::memory_order_relaxed);
+    }
+    
+    void addCallFaults(uint64_t faults) {
+        call_faults.fetch_add(faults, std::memory_order_relaxed);
+    }
+    
+    void latencyStats(PSNN_LatencyStats& stats) const {
+        std::memset(&stats, 0, sizeof(stats));
+        stats.low_latency = low_latency ? 1 : 0;
+        stats.pinned_cpu = pinned_cpu;
+        stats.pinned_threads = pinned_threads.load();
+        if (!low_latency) {
+            return;
+        }
+        stats.process_locked = process_locked ? 1 : 0;
+        if (pool) {
+            stats.pool_pages = static_cast<int>(pool->pool.pages());
+            stats.pool_locked = pool->pool.locked() ? 1 : 0;
+            stats.pool_bytes = pool->pool.capacity();
+            stats.pool_used_bytes = pool->pool.used();
+            stats.allocations_after_warmup = pool->fresh_after_warmup.load();
+            stats.pool_overflows = pool->pool.overflows();
+        }
+        stats.predict_page_faults = call_faults.load();
+    }
+    
+    // Stop ORT's profiler and report where it wrote its events; false if it was not running
+    bool endProfiling(OrtProfile& profile) {
+        if (!profiling) {
+            return false;
+        }
+        profiling = false;
+        auto path = session->EndProfilingAllocated(allocator);
+        profile.path = path.get();
+        profile.start_ns = session->GetProfilingStartTimeNs();
+        return true;
+    }
+    
+    // Worker pool for PSNN_PredictBulk, started on first use and kept for the life of the session
+    WorkStealingPool& bulkPool() {
+        std::lock_guard<std::mutex> lock(bulk_pool_mutex);
+        if (!bulk_pool) {
+            bulk_pool.reset(new WorkStealingPool(std::max(1u, std::thread::hardware_concurrency())));
+        }
+        return *bulk_pool;
+    }
+    
+    // Run rows standardised rows as one batch; writes NUM_CLASSES probabilities per row.
+    // Safe to call from several threads at once.
+    bool runBatch(const float* input_values, size_t rows, float* output_probs) {
+        try {
+            Ort::Value input_tensor(nullptr);
+            std::vector<int64_t> input_shape = {static_cast<int64_t>(rows), static_cast<int64_t>(KEPT_FEATURE_COUNT)};
+            {
+                TraceSpan span("tensor build");
+                Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+                input_tensor = Ort::Value::CreateTensor<float>(
+                    memory_info, const_cast<float*>(input_values), rows * KEPT_FEATURE_COUNT,
+                    input_shape.data(), input_shape.size());
+            }
+            
+            std::vector<Ort::Value> output_tensors;
+            {
+                TraceSpan span("Session::Run");
+                output_tensors = session->Run(
+                    run_options,
+                    input_names.data(), &input_tensor, 1,
+                    output_names.data(), output_names.size()
+                );
+            }
+            
+            TraceSpan span("extract");
+            const float* output_data = output_tensors[0].GetTensorMutableData<float>();
+            std::memcpy(output_probs, output_data, rows * NUM_CLASSES * sizeof(float));
+            return true;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Inference error: " << e.what() << std::endl;
+            return false;
+        }
     }
     
     bool runInference(const std::vector<float>& input_values, std::vector<float>& output_probs) {
         try {
             // Create input tensor
             std::vector<int64_t> input_shape = {1, static_cast<int64_t>(input_values.size())};
-            Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-            
             std::vector<Ort::Value> input_tensors;
-            input_tensors.push_back(Ort::Value::CreateTensor<float>(
-                memory_info, const_cast<float*>(input_values.data()), input_values.size(),
-                input_shape.data(), input_shape.size()));
+            {
+                TraceSpan span("tensor build");
+                Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+                input_tensors.push_back(Ort::Value::CreateTensor<float>(
+                    memory_info, const_cast<float*>(input_values.data()), input_values.size(),
+                    input_shape.data(), input_shape.size()));
+            }
             
             // Run inference
-            auto output_tensors = session->Run(
-                Ort::RunOptions{nullptr}, 
-                input_names.data(), input_tensors.data(), input_tensors.size(),
-                output_names.data(), output_names.size()
-            );
+            std::vector<Ort::Value> output_tensors;
+            {
+                TraceSpan span("Session::Run");
+                output_tensors = session->Run(
+                    run_options, 
+                    input_names.data(), input_tensors.data(), input_tensors.size(),
+                    output_names.data(), output_names.size()
+                );
+            }
             
             // Get output data
+            TraceSpan span("extract");
             float* output_data = output_tensors[0].GetTensorMutableData<float>();
             
             // Get output size
@@ -161,10 +476,174 @@ public:
 // Global instance (initialized on first use)
 static ONNXInference* g_inference = nullptr;
 
+// Prediction service on g_inference, if started. Callers take their own reference
+// with currentService(), so a service stopped during a call is freed after it.
+static std::shared_ptr<PredictionService> g_service;
+static std::mutex g_service_mutex;
+
+static std::shared_ptr<PredictionService> currentService() {
+    std::lock_guard<std::mutex> lock(g_service_mutex);
+    return g_service;
+}
+
+static void stopService() {
+    std::shared_ptr<PredictionService> service;
+    {
+        std::lock_guard<std::mutex> lock(g_service_mutex);
+        service.swap(g_service);
+    }
+    // Returns once every caller inside submit() has left it
+    if (service) {
+        service->stop();
+    }
+}
+
+// Recorder of PSNN_Predict calls, if started
+static RecordingWriter g_recorder;
+static std::atomic<bool> g_recording{false};
+
+// Fill a result structure from one row of class probabilities
+static void fillResult(const float* probs, PredictionResult& result) {
+    result.predicted_class = 0;
+    for (size_t c = 0; c < NUM_CLASSES; c++) {
+        result.class_probabilities[c] = probs[c];
+        if (probs[c] > probs[result.predicted_class]) {
+            result.predicted_class = static_cast<int>(c);
+        }
+    }
+    result.confidence = probs[result.predicted_class];
+}
+
+// Run inference on a standardised row and fill the result structure
+static bool predictStandardised(const std::vector<float>& float_values, PredictionResult* result) {
+    std::vector<float> output_probs;
+    if (!g_inference->runInference(float_values, output_probs)) {
+        return false;
+    }
+    
+    // Fill result structure
+    TraceSpan span("extract");
+    for (size_t i = 0; i < 3 && i < output_probs.size(); i++) {
+        result->class_probabilities[i] = output_probs[i];
+    }
+    
+    // Find predicted class
+    int max_index = 0;
+    float max_prob = output_probs[0];
+    for (size_t i = 1; i < output_probs.size(); i++) {
+        if (output_probs[i] > max_prob) {
+            max_prob = output_probs[i];
+            max_index = i;
+        }
+    }
+    
+    result->predicted_class = max_index;
+    result->confidence = max_prob;
+    
+    return true;
+}
+
+// Run the single-event path on a typical row until ORT's pool and the heap hold
+// everything it needs
+static void warmUp(int runs) {
+    std::vector<double> raw(FEATURE_COUNT, 0.0);
+    std::vector<float> float_values(KEPT_FEATURE_COUNT);
+    PredictionResult result;
+    for (int i = 0; i < runs; i++) {
+        standardiseRow(raw.data(), float_values.data());
+        predictStandardised(float_values, &result);
+    }
+}
+
+// Opaque run summary handed out by PSNN_SummaryCreate
+struct PSNN_Summary {
+    RunSummary data;
+};
+
+// Client side of the shared-memory transport handed out by PSNN_ShmConnect
+struct PSNN_ShmClient {
+    ShmRing ring;
+};
+
+// Result store handed out by PSNN_ResultStoreOpen
+struct PSNN_ResultStore {
+    ResultStore store;
+};
+
+// Score n_rows raw rows on the session's work-stealing pool, tile by tile. Each tile
+// writes its own slice of results (if given); summary (if given) receives the
+// per-worker partial summaries merged after the last tile.
+static bool predictBulk(const double* values, size_t n_rows, int n_threads,
+                        PredictionResult* results, RunSummary* summary) {
+    if (n_rows == 0) {
+        return true;
+    }
+    
+    static const size_t tile_rows = bulkTileRows();
+    size_t n_tiles = (n_rows + tile_rows - 1) / tile_rows;
+    WorkStealingPool& pool = g_inference->bulkPool();
+    
+    // Per-worker scratch, reused for every tile the worker takes
+    size_t n_workers = pool.size();
+    std::vector<std::vector<float>> inputs(n_workers);
+    std::vector<std::vector<float>> probs(n_workers);
+    std::vector<RunSummary> partials(summary ? n_workers : 0);
+    for (RunSummary& partial : partials) {
+        initSummary(partial, std::vector<double>(summary->thresholds, summary->thresholds + summary->n_thresholds));
+    }
+    std::atomic<bool> ok{true};
+    
+    pool.parallelFor(n_tiles, static_cast<size_t>(n_threads), [&](size_t tile, size_t worker) {
+        size_t first = tile * tile_rows;
+        size_t n = std::min(tile_rows, n_rows - first);
+        std::vector<float>& in = inputs[worker];
+        std::vector<float>& out = probs[worker];
+        in.resize(tile_rows * KEPT_FEATURE_COUNT);
+        out.resize(tile_rows * NUM_CLASSES);
+        
+        TraceRequest request;
+        {
+            TraceSpan span("standardise");
+            bool drift = driftMonitorEnabled();
+            uint32_t zeroed[KEPT_FEATURE_COUNT] = {};
+            for (size_t r = 0; r < n; r++) {
+                standardiseRow(values + (first + r) * FEATURE_COUNT, in.data() + r * KEPT_FEATURE_COUNT,
+                               drift ? zeroed : nullptr);
+            }
+            if (drift) {
+                recordDrift(in.data(), n, zeroed);
+            }
+        }
+        if (!g_inference->runBatch(in.data(), n, out.data())) {
+            ok = false;
+            return;
+        }
+        
+        TraceSpan span("extract");
+        if (summary) {
+            for (size_t r = 0; r < n; r++) {
+                addToSummary(partials[worker], out.data() + r * NUM_CLASSES);
+            }
+        }
+        if (!results) {
+            return;
+        }
+        for (size_t r = 0; r < n; r++) {
+            fillResult(out.data() + r * NUM_CLASSES, results[first + r]);
+        }
+    });
+    
+    if (!ok.load()) {
+        return false;
+    }
+    for (const RunSummary& partial : partials) {
+        mergeSummary(*summary, partial);
+    }
+    return true;
+}
+
 // DLL entry point
 #ifdef _WIN32
-#include <windows.h>
-
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
     switch (ul_reason_for_call) {
         case DLL_PROCESS_ATTACH:
@@ -172,6 +651,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
             break;
         case DLL_PROCESS_DETACH:
             // Cleanup when DLL is unloaded
+            stopService();
             if (g_inference) {
                 delete g_inference;
                 g_inference = nullptr;
@@ -182,6 +662,71 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
 }
 #endif
 
+// Adds the page faults the calling thread takes during a single-event call to the session's count,
+// once a low-latency session has warmed up. Other threads of the host are not counted.
+class CallFaultCounter {
+public:
+    explicit CallFaultCounter(ONNXInference* inference)
+        : inference(inference->countingFaults() ? inference : nullptr), start(this->inference ? threadPageFaults() : 0) {}
+    
+    ~CallFaultCounter() {
+        if (inference) {
+            uint64_t now = threadPageFaults();
+            inference->addCallFaults(now > start ? now - start : 0);
+        }
+    }
+    
+private:
+    ONNXInference* inference;
+    uint64_t start;
+};
+
+// Body of PSNN_Predict
+static bool predictNamed(const char** names, const double* values, int num_features, PredictionResult* result) {
+    if (!g_inference || !names || !values || !result) {
+        return false;
+    }
+    g_inference->pinCallingThread();
+    CallFaultCounter faults(g_inference);
+    
+    TraceRequest request;
+    
+    // Drop features; the rest keep their call order
+    double kept_values[KEPT_FEATURE_COUNT];
+    size_t n_kept = 0;
+    {
+        TraceSpan span("drop");
+        for (int i = 0; i < num_features; i++) {
+            if (!names[i]) {
+                return false;
+            }
+            if (isDroppedFeature(names[i])) {
+                continue;
+            }
+            if (n_kept == KEPT_FEATURE_COUNT) {
+                return false;
+            }
+            kept_values[n_kept++] = values[i];
+        }
+    }
+    
+    // Standardize by position
+    std::vector<float> float_values(n_kept);
+    {
+        TraceSpan span("standardise");
+        uint32_t zeroed[KEPT_FEATURE_COUNT] = {};
+        for (size_t i = 0; i < n_kept; i++) {
+            if (PLAN_SCALE[i] == 0.0 && kept_values[i] != MEANS[i]) zeroed[i]++;
+            float_values[i] = static_cast<float>(standardiseValue(i, kept_values[i]));
+        }
+        if (n_kept == KEPT_FEATURE_COUNT) {
+            recordDrift(float_values.data(), 1, zeroed);
+        }
+    }
+    
+    return predictStandardised(float_values, result);
+}
+
 // The main function that RDP will call
 extern "C" {
 
@@ -192,11 +737,77 @@ extern "C" {
  * @return true if successful, false otherwise
  */
 PSNN_API bool PSNN_Initialize(const char* model_path) {
+    PSNN_InitOptions options;
+    PSNN_DefaultInitOptions(&options);
+    return PSNN_InitializeWithOptions(model_path, &options);
+}
+
+/**
+ * Fill an options structure with the defaults used by PSNN_Initialize
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultInitOptions(PSNN_InitOptions* options) {
+    if (!options) {
+        return;
+    }
+    std::memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(PSNN_InitOptions);
+    options->arena_extend_strategy = -1;
+    options->initial_chunk_size_bytes = 0;
+    options->shrink_arena_after_run = 0;
+    options->enable_mem_pattern = 1;
+    options->low_latency = 0;
+    options->locked_pool_bytes = 0;
+    options->pin_cpu = PSNN_PIN_CURRENT_CPU;
+    options->pin_callers = 0;
+    options->warmup_runs = 1000;
+    options->lock_process_memory = 0;
+}
+
+/**
+ * Initialize the PSNN model with memory options
+ * 
+ * @param model_path Path to the ONNX model file
+ * @param options Options filled by PSNN_DefaultInitOptions and adjusted by the caller
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_InitializeWithOptions(const char* model_path, const PSNN_InitOptions* options) {
+    // ORT takes the first chunk size as an int
+    if (!model_path || !options || options->struct_size != sizeof(PSNN_InitOptions) || options->warmup_runs < 0 ||
+        options->initial_chunk_size_bytes > static_cast<size_t>(INT_MAX)) {
+        return false;
+    }
+    
     try {
+        stopService();
         if (g_inference) {
             delete g_inference;
+            g_inference = nullptr;
+        }
+        
+        // Pin before the session allocates anything, so its memory is first touched (and warm-up run)
+        // on the CPU that will use it. The host's thread gets its own affinity back on return unless
+        // callers are to stay pinned, and on failure
+        std::unique_ptr<ScopedThreadPin> init_pin;
+        if (options->low_latency && options->pin_cpu != PSNN_PIN_NONE) {
+            init_pin.reset(new ScopedThreadPin(options->pin_cpu));
+            if (init_pin->cpu() < 0) {
+                std::cerr << "Warning: Could not pin the initialising thread." << std::endl;
+            }
+        }
+        g_inference = new ONNXInference(model_path, *options, init_pin ? init_pin->cpu() : -1);
+        
+        // Build the feature name lookup table now rather than on the first call
+        featureIndex("");
+        
+        if (g_inference->lowLatency()) {
+            warmUp(options->warmup_runs);
+            g_inference->finishWarmup();
+        }
+        if (init_pin && options->pin_callers) {
+            init_pin->keep();
         }
-        g_inference = new ONNXInference(model_path);
         return true;
     }
     catch (const std::exception& e) {
@@ -205,6 +816,20 @@ PSNN_API bool PSNN_Initialize(const char* model_path) {
     }
 }
 
+/**
+ * Read the state of the low-latency setup
+ * 
+ * @param stats Output structure
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_GetLatencyStats(PSNN_LatencyStats* stats) {
+    if (!g_inference || !stats) {
+        return false;
+    }
+    g_inference->latencyStats(*stats);
+    return true;
+}
+
 /**
  * Process input data and return predictions
  * 
@@ -215,69 +840,621 @@ PSNN_API bool PSNN_Initialize(const char* model_path) {
  * @return true if successful, false otherwise
  */
 PSNN_API bool PSNN_Predict(const char** names, const double* values, int num_features, PredictionResult* result) {
-    if (!g_inference || !names || !values || !result) {
-        return false;
+    if (!g_recording.load(std::memory_order_acquire)) {
+        return predictNamed(names, values, num_features, result);
     }
     
-    // Copy data into vectors for processing
-    std::vector<std::string> feature_names;
-    std::vector<double> feature_values;
-    
-    for (int i = 0; i < num_features; i++) {
-        feature_names.push_back(names[i]);
-        feature_values.push_back(values[i]);
+    uint64_t arrived = g_recorder.now();
+    bool ok = predictNamed(names, values, num_features, result);
+    uint64_t latency = g_recorder.now() - arrived;
+    g_recorder.record(arrived, latency, names, values, num_features, ok ? result->class_probabilities : nullptr,
+                      ok ? result->predicted_class : -1);
+    return ok;
+}
+
+/**
+ * Process a sparse event and return predictions
+ * 
+ * @param indices Feature indices (canonical order) of the non-zero values
+ * @param values Non-zero feature values
+ * @param nnz Number of index/value pairs
+ * @param result Output structure for predictions
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_PredictSparse(const int* indices, const double* values, int nnz, PredictionResult* result) {
+    if (!g_inference || (nnz > 0 && (!indices || !values)) || nnz < 0 || !result) {
+        return false;
     }
+    g_inference->pinCallingThread();
+    CallFaultCounter faults(g_inference);
     
-    // Drop features
-    for (size_t i = 0; i < feature_names.size(); ) {
-        if (std::find(DROP_NAMES.begin(), DROP_NAMES.end(), feature_names[i]) != DROP_NAMES.end()) {
-            feature_names.erase(feature_names.begin() + i);
-            feature_values.erase(feature_values.begin() + i);
-        } else {
-            ++i;
+    TraceRequest request;
+    
+    // Start from the precomputed standardised zero row and patch in the non-zero entries
+    std::vector<float> float_values(KEPT_FEATURE_COUNT);
+    {
+        TraceSpan span("standardise");
+        uint32_t zeroed[KEPT_FEATURE_COUNT] = {};
+        if (standardiseSparse(indices, values, nnz, float_values.data(), zeroed) != 0) {
+            return false;
         }
+        recordDrift(float_values.data(), 1, zeroed);
     }
     
-    // Standardize
-    if (feature_names.size() > STD_DEV.size() || feature_names.size() > MEANS.size()) {
+    return predictStandardised(float_values, result);
+}
+
+/**
+ * Process many dense events in parallel
+ * 
+ * @param values n_rows * FEATURE_COUNT raw values in FEATURE_NAMES order
+ * @param n_rows Number of events
+ * @param results Output structures, one per event
+ * @param n_threads Maximum threads to use, 0 = all cores
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_PredictBulk(const double* values, size_t n_rows, PredictionResult* results, int n_threads) {
+    if (!g_inference || (n_rows > 0 && (!values || !results)) || n_threads < 0) {
+        return false;
+    }
+    return predictBulk(values, n_rows, n_threads, results, nullptr);
+}
+
+/**
+ * Fill a service options structure with defaults
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultServiceOptions(PSNN_ServiceOptions* options) {
+    if (!options) {
+        return;
+    }
+    ServiceOptions defaults;
+    std::memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(PSNN_ServiceOptions);
+    options->interactive_queue_capacity = defaults.queue_capacity[PRIORITY_INTERACTIVE];
+    options->bulk_queue_capacity = defaults.queue_capacity[PRIORITY_BULK];
+    options->n_threads = 0;
+    options->tile_rows = 0;
+}
+
+/**
+ * Start the prediction service
+ * 
+ * @param options Options filled by PSNN_DefaultServiceOptions and adjusted by the caller
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_StartService(const PSNN_ServiceOptions* options) {
+    if (!g_inference || !options || options->struct_size != sizeof(PSNN_ServiceOptions) || options->n_threads < 0) {
         return false;
     }
     
-    for (size_t i = 0; i < feature_names.size(); i++) {
-        if (std::abs(STD_DEV[i]) < 1e-10) {
-            feature_values[i] = 0.0;
-        } else {
-            feature_values[i] = (feature_values[i] - MEANS[i]) / STD_DEV[i];
-        }
+    ServiceOptions service_options;
+    service_options.queue_capacity[PRIORITY_INTERACTIVE] = options->interactive_queue_capacity;
+    service_options.queue_capacity[PRIORITY_BULK] = options->bulk_queue_capacity;
+    service_options.threads = static_cast<size_t>(options->n_threads);
+    service_options.tile_rows = options->tile_rows > 0 ? options->tile_rows : bulkTileRows();
+    
+    try {
+        stopService();
+        ONNXInference* inference = g_inference;
+        std::shared_ptr<PredictionService> service = std::make_shared<PredictionService>(
+            service_options, [inference](const float* inputs, size_t rows, float* probs) {
+                return inference->runBatch(inputs, rows, probs);
+            });
+        std::lock_guard<std::mutex> lock(g_service_mutex);
+        g_service = std::move(service);
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Service error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+/**
+ * Fill a request options structure with defaults
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultRequestOptions(PSNN_RequestOptions* options) {
+    if (!options) {
+        return;
+    }
+    std::memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(PSNN_RequestOptions);
+    options->priority = PSNN_PRIORITY_INTERACTIVE;
+    options->deadline_ms = 0.0;
+}
+
+/**
+ * Predict dense events through the prediction service
+ * 
+ * @param values n_rows * FEATURE_COUNT raw values in FEATURE_NAMES order
+ * @param n_rows Number of events
+ * @param results Output structures, one per event
+ * @param options Priority and deadline (NULL = interactive, no deadline)
+ * @return PSNN_STATUS_* code
+ */
+PSNN_API int PSNN_PredictRequest(const double* values, size_t n_rows, PredictionResult* results,
+                                 const PSNN_RequestOptions* options) {
+    PSNN_RequestOptions defaults;
+    PSNN_DefaultRequestOptions(&defaults);
+    if (!options) {
+        options = &defaults;
+    }
+    std::shared_ptr<PredictionService> service = currentService();
+    if (!service || (n_rows > 0 && (!values || !results)) || options->struct_size != sizeof(PSNN_RequestOptions) ||
+        (options->priority != PSNN_PRIORITY_INTERACTIVE && options->priority != PSNN_PRIORITY_BULK) ||
+        options->deadline_ms < 0.0) {
+        return PSNN_STATUS_ERROR;
     }
     
-    // Convert to float for inference
-    std::vector<float> float_values(feature_values.begin(), feature_values.end());
+    // The deadline is taken from the moment of the call, before any queueing
+    auto deadline = PredictionService::NO_DEADLINE;
+    if (options->deadline_ms > 0.0) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(options->deadline_ms));
+    }
     
-    // Run inference
-    std::vector<float> output_probs;
-    if (!g_inference->runInference(float_values, output_probs)) {
+    try {
+        std::vector<float> probs(n_rows * NUM_CLASSES);
+        int status = service->submit(values, n_rows, probs.data(),
+                                     options->priority == PSNN_PRIORITY_BULK ? PRIORITY_BULK : PRIORITY_INTERACTIVE,
+                                     deadline);
+        if (status != SERVICE_OK) {
+            return status;
+        }
+        for (size_t r = 0; r < n_rows; r++) {
+            fillResult(probs.data() + r * NUM_CLASSES, results[r]);
+        }
+        return PSNN_STATUS_OK;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Service error: " << e.what() << std::endl;
+        return PSNN_STATUS_ERROR;
+    }
+}
+
+/**
+ * Report the service's counters and queue depths
+ * 
+ * @param stats Output structure
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_GetServiceStats(PSNN_ServiceStats* stats) {
+    std::shared_ptr<PredictionService> service = currentService();
+    if (!service || !stats) {
+        return false;
+    }
+    ServiceStats data = service->stats();
+    for (size_t p = 0; p < PRIORITY_COUNT; p++) {
+        stats->completed[p] = data.completed[p];
+        stats->expired[p] = data.expired[p];
+        stats->rejected[p] = data.rejected[p];
+        stats->failed[p] = data.failed[p];
+        stats->queued[p] = data.queued[p];
+    }
+    return true;
+}
+
+/**
+ * Stop the prediction service
+ */
+PSNN_API void PSNN_StopService() {
+    stopService();
+}
+
+/**
+ * Create an empty run summary
+ * 
+ * @param thresholds Probability thresholds to count events above
+ * @param n_thresholds Number of thresholds (at most PSNN_SUMMARY_MAX_THRESHOLDS)
+ * @return New summary, or NULL on invalid arguments
+ */
+PSNN_API PSNN_Summary* PSNN_SummaryCreate(const double* thresholds, int n_thresholds) {
+    if (n_thresholds < 0 || n_thresholds > PSNN_SUMMARY_MAX_THRESHOLDS || (n_thresholds > 0 && !thresholds)) {
+        return nullptr;
+    }
+    PSNN_Summary* summary = new PSNN_Summary;
+    initSummary(summary->data, std::vector<double>(thresholds, thresholds + n_thresholds));
+    return summary;
+}
+
+/**
+ * Process many dense events in parallel, adding them to a summary only
+ * 
+ * @param values n_rows * FEATURE_COUNT raw values in FEATURE_NAMES order
+ * @param n_rows Number of events
+ * @param summary Summary to add the events to
+ * @param n_threads Maximum threads to use, 0 = all cores
+ * @return true if successful, false otherwise (the summary is then unchanged)
+ */
+PSNN_API bool PSNN_PredictBulkSummary(const double* values, size_t n_rows, PSNN_Summary* summary, int n_threads) {
+    if (!g_inference || (n_rows > 0 && !values) || !summary || n_threads < 0) {
+        return false;
+    }
+    return predictBulk(values, n_rows, n_threads, nullptr, &summary->data);
+}
+
+/**
+ * Read the aggregates of a summary
+ * 
+ * @param summary Summary
+ * @param report Output structure
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_SummaryGetReport(const PSNN_Summary* summary, PSNN_SummaryReport* report) {
+    if (!summary || !report) {
         return false;
     }
+    static const double quantiles[5] = {0.05, 0.25, 0.5, 0.75, 0.95};
     
-    // Fill result structure
-    for (size_t i = 0; i < 3 && i < output_probs.size(); i++) {
-        result->class_probabilities[i] = output_probs[i];
+    const RunSummary& data = summary->data;
+    std::memset(report, 0, sizeof(*report));
+    report->events = data.events;
+    for (size_t c = 0; c < NUM_CLASSES; c++) {
+        report->class_counts[c] = data.class_counts[c];
+        for (size_t q = 0; q < 5; q++) {
+            report->confidence_quantiles[c][q] = static_cast<float>(summaryQuantile(data, c, quantiles[q]));
+        }
+    }
+    report->n_thresholds = static_cast<int>(data.n_thresholds);
+    for (size_t t = 0; t < data.n_thresholds; t++) {
+        report->thresholds[t] = data.thresholds[t];
+        for (size_t c = 0; c < NUM_CLASSES; c++) {
+            report->above_threshold[c][t] = data.above_threshold[c][t];
+        }
+    }
+    return true;
+}
+
+/**
+ * Write a summary as a compact CSV report
+ * 
+ * @param summary Summary
+ * @param path Output file path
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_SummaryWrite(const PSNN_Summary* summary, const char* path) {
+    if (!summary || !path) {
+        return false;
+    }
+    return writeSummary(path, summary->data) == 0;
+}
+
+/**
+ * Free a summary
+ * 
+ * @param summary Summary from PSNN_SummaryCreate (NULL is ignored)
+ */
+PSNN_API void PSNN_SummaryFree(PSNN_Summary* summary) {
+    delete summary;
+}
+
+/**
+ * Connect to a resident PSNN server
+ * 
+ * @param name Shared memory name of the server
+ * @return Connection, or NULL on failure
+ */
+PSNN_API PSNN_ShmClient* PSNN_ShmConnect(const char* name) {
+    if (!name) {
+        return nullptr;
+    }
+    std::unique_ptr<PSNN_ShmClient> client(new PSNN_ShmClient);
+    std::string ring_name = name[0] == '/' ? name : std::string("/") + name;
+    if (client->ring.open(ring_name) != 0) {
+        return nullptr;
+    }
+    return client.release();
+}
+
+/**
+ * Predict one event through a resident PSNN server
+ * 
+ * @param client Connection
+ * @param values Raw feature values in canonical order
+ * @param result Output structure for predictions
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_ShmPredict(PSNN_ShmClient* client, const double* values, PredictionResult* result) {
+    if (!client || !values || !result) {
+        return false;
+    }
+    int32_t predicted_class = 0;
+    if (client->ring.predict(values, result->class_probabilities, &predicted_class) != 0) {
+        return false;
+    }
+    result->predicted_class = predicted_class;
+    result->confidence = result->class_probabilities[predicted_class];
+    return true;
+}
+
+/**
+ * Close a connection to a resident PSNN server
+ * 
+ * @param client Connection (NULL is ignored)
+ */
+PSNN_API void PSNN_ShmDisconnect(PSNN_ShmClient* client) {
+    delete client;
+}
+
+/**
+ * Fill a tracing options structure with defaults
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultTraceOptions(PSNN_TraceOptions* options) {
+    if (!options) {
+        return;
+    }
+    TraceOptions defaults;
+    std::memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(PSNN_TraceOptions);
+    options->sample_rate = defaults.sample_rate;
+    options->ring_spans = defaults.ring_spans;
+    options->ort_profiling = 0;
+}
+
+/**
+ * Turn on stage tracing
+ * 
+ * @param options Options filled by PSNN_DefaultTraceOptions and adjusted by the caller
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_EnableTracing(const PSNN_TraceOptions* options) {
+    if (!options || options->struct_size != sizeof(PSNN_TraceOptions) ||
+        options->sample_rate < 0.0 || options->sample_rate > 1.0) {
+        return false;
+    }
+    TraceOptions trace_options;
+    trace_options.sample_rate = options->sample_rate;
+    trace_options.ring_spans = options->ring_spans > 0 ? options->ring_spans : trace_options.ring_spans;
+    trace_options.ort_profiling = options->ort_profiling != 0;
+    enableTracing(trace_options);
+    return true;
+}
+
+/**
+ * Write the recorded trace, merged with ORT's profiler output, as Chrome trace JSON
+ * 
+ * @param path Output file path
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_WriteTrace(const char* path) {
+    if (!path || !tracingEnabled()) {
+        return false;
     }
     
-    // Find predicted class
-    int max_index = 0;
-    float max_prob = output_probs[0];
-    for (size_t i = 1; i < output_probs.size(); i++) {
-        if (output_probs[i] > max_prob) {
-            max_prob = output_probs[i];
-            max_index = i;
+    try {
+        std::vector<OrtProfile> ort_profiles;
+        OrtProfile profile;
+        if (g_inference && g_inference->endProfiling(profile)) {
+            ort_profiles.push_back(profile);
         }
+        
+        std::vector<std::string> events;
+        int rc = collectTraceEvents(ort_profiles, events);
+        return writeChromeTrace(path, events) == 0 && rc == 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Trace error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+/**
+ * Fill a drift monitor options structure with defaults
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultDriftOptions(PSNN_DriftOptions* options) {
+    if (!options) {
+        return;
+    }
+    DriftOptions defaults;
+    std::memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(PSNN_DriftOptions);
+    options->max_mean_shift = defaults.max_mean_shift;
+    options->max_variance_ratio = defaults.max_variance_ratio;
+    options->max_zeroed_fraction = defaults.max_zeroed_fraction;
+    options->min_events = defaults.min_events;
+    options->merge_rows = defaults.merge_rows;
+}
+
+/**
+ * Turn on input drift monitoring
+ * 
+ * @param options Options filled by PSNN_DefaultDriftOptions and adjusted by the caller
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_EnableDriftMonitor(const PSNN_DriftOptions* options) {
+    if (!options || options->struct_size != sizeof(PSNN_DriftOptions) || options->max_mean_shift <= 0.0 ||
+        options->max_variance_ratio <= 1.0 || options->max_zeroed_fraction < 0.0) {
+        return false;
+    }
+    DriftOptions drift_options;
+    drift_options.max_mean_shift = options->max_mean_shift;
+    drift_options.max_variance_ratio = options->max_variance_ratio;
+    drift_options.max_zeroed_fraction = options->max_zeroed_fraction;
+    drift_options.min_events = options->min_events;
+    drift_options.merge_rows = options->merge_rows > 0 ? options->merge_rows : drift_options.merge_rows;
+    enableDriftMonitor(drift_options);
+    return true;
+}
+
+/**
+ * Read the drift of every input feature so far
+ * 
+ * @param report Output structure
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_GetDriftReport(PSNN_DriftReport* report) {
+    static_assert(PSNN_KEPT_FEATURES == KEPT_FEATURE_COUNT, "PSNN_KEPT_FEATURES must match the model input");
+    if (!report || !driftMonitorEnabled()) {
+        return false;
     }
     
-    result->predicted_class = max_index;
-    result->confidence = max_prob;
+    std::unique_ptr<DriftStats> stats(new DriftStats);
+    driftSnapshot(*stats);
+    std::vector<DriftFeature> features;
+    size_t flagged = checkDrift(*stats, driftOptions(), features);
     
+    std::memset(report, 0, sizeof(*report));
+    report->events = stats->events;
+    report->n_flagged = static_cast<int>(flagged);
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        PSNN_DriftFeature& out = report->features[k];
+        out.feature = static_cast<int>(features[k].feature);
+        out.mean_shift = features[k].mean_shift;
+        out.variance_ratio = features[k].variance_ratio;
+        out.zeroed = features[k].zeroed;
+        out.non_finite = features[k].non_finite;
+        out.flagged = features[k].flagged ? 1 : 0;
+    }
+    return true;
+}
+
+/**
+ * Write the drift report as CSV
+ * 
+ * @param path Output file path
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_WriteDriftReport(const char* path) {
+    if (!path || !driftMonitorEnabled()) {
+        return false;
+    }
+    std::unique_ptr<DriftStats> stats(new DriftStats);
+    driftSnapshot(*stats);
+    return writeDriftReport(path, *stats, driftOptions()) == 0;
+}
+
+/**
+ * Start recording every PSNN_Predict call
+ * 
+ * @param path Output file path
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_StartRecording(const char* path) {
+    if (!path) {
+        return false;
+    }
+    g_recording.store(false, std::memory_order_release);
+    if (g_recorder.open(path) != 0) {
+        return false;
+    }
+    g_recording.store(true, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Stop recording and close the file
+ * 
+ * @return true if every record was written, false otherwise
+ */
+PSNN_API bool PSNN_StopRecording() {
+    g_recording.store(false, std::memory_order_release);
+    return g_recorder.close() == 0;
+}
+
+/**
+ * Write results as a result store indexed by event ID
+ * 
+ * @param path Output file path
+ * @param ids Event IDs
+ * @param results Results
+ * @param n_rows Number of events
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_ResultStoreWrite(const char* path, const PSNN_EventId* ids, const PredictionResult* results,
+                                    size_t n_rows) {
+    if (!path || (n_rows > 0 && (!ids || !results))) {
+        return false;
+    }
+    try {
+        std::vector<StoredResult> records(n_rows);
+        for (size_t i = 0; i < n_rows; i++) {
+            std::memcpy(&records[i].id, &ids[i], sizeof(EventId));
+            std::memcpy(records[i].class_probabilities, results[i].class_probabilities,
+                        sizeof(records[i].class_probabilities));
+            records[i].predicted_class = results[i].predicted_class;
+        }
+        return writeResultStore(path, records) == 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+/**
+ * Map a result store read-only
+ * 
+ * @param path Store file path
+ * @return Store, or NULL on failure
+ */
+PSNN_API PSNN_ResultStore* PSNN_ResultStoreOpen(const char* path) {
+    if (!path) {
+        return nullptr;
+    }
+    PSNN_ResultStore* store = new PSNN_ResultStore;
+    if (store->store.open(path) != 0) {
+        delete store;
+        return nullptr;
+    }
+    return store;
+}
+
+/**
+ * Look up the result of one event
+ * 
+ * @param store Store from PSNN_ResultStoreOpen
+ * @param id Event ID
+ * @return Result inside the store, or NULL if it does not hold the event
+ */
+PSNN_API const PSNN_StoredResult* PSNN_LookupResult(const PSNN_ResultStore* store, const PSNN_EventId* id) {
+    if (!store || !id) {
+        return nullptr;
+    }
+    const StoredResult* record = store->store.find(*reinterpret_cast<const EventId*>(id));
+    return reinterpret_cast<const PSNN_StoredResult*>(record);
+}
+
+/**
+ * Number of events in a result store
+ * 
+ * @param store Store from PSNN_ResultStoreOpen
+ * @return Number of events, 0 for NULL
+ */
+PSNN_API size_t PSNN_ResultStoreSize(const PSNN_ResultStore* store) {
+    return store ? store->store.size() : 0;
+}
+
+/**
+ * Unmap a result store
+ * 
+ * @param store Store from PSNN_ResultStoreOpen, or NULL
+ */
+PSNN_API void PSNN_ResultStoreClose(PSNN_ResultStore* store) {
+    delete store;
+}
+
+/**
+ * Report resident memory of the process and its growth while the current
+ * session was initialised
+ * 
+ * @param stats Output structure
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_GetMemoryStats(PSNN_MemoryStats* stats) {
+    if (!stats) {
+        return false;
+    }
+    stats->process_resident_bytes = residentBytes();
+    stats->init_resident_delta_bytes = g_inference ? g_inference->initResidentDelta() : 0;
+    stats->live_sessions = g_session_count.load();
     return true;
 }
 
@@ -285,6 +1462,7 @@ PSNN_API bool PSNN_Predict(const char** names, const double* values, int num_fea
  * Cleanup resources
  */
 PSNN_API void PSNN_Cleanup() {
+    stopService();
     if (g_inference) {
         delete g_inference;
         g_inference = nullptr;
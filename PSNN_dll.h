@@ -2,6 +2,8 @@
 #ifndef PSNN_DLL_H
 #define PSNN_DLL_H
 
+#include <stddef.h>
+
 // Windows-specific DLL export/import macros
 #ifdef _WIN32
     #ifdef PSNN_EXPORTS
@@ -20,6 +22,162 @@ struct PredictionResult {
     float confidence;              // Confidence (probability) of predicted class
 };
 
+// Options for PSNN_InitializeWithOptions; fill with PSNN_DefaultInitOptions first
+struct PSNN_InitOptions {
+    unsigned int struct_size;         // sizeof(PSNN_InitOptions), set by PSNN_DefaultInitOptions
+    int arena_extend_strategy;        // -1 = ORT default, 0 = next power of two, 1 = same as requested
+    size_t initial_chunk_size_bytes;  // First arena chunk size, 0 = ORT default; at most INT_MAX
+    int shrink_arena_after_run;       // Non-zero: release unused arena chunks after every Run
+    int enable_mem_pattern;           // Non-zero (default): pre-plan activation buffers per input shape
+    int low_latency;                  // Non-zero: serve ORT from a locked, pre-faulted pool, pin and warm up (see below)
+    size_t locked_pool_bytes;         // Size of the low-latency pool, 0 = 16 MB
+    int pin_cpu;                      // Low latency: CPU to pin to, PSNN_PIN_CURRENT_CPU or PSNN_PIN_NONE (see below)
+    int pin_callers;                  // Low latency, opt-in: keep threads that call PSNN_Predict* pinned (see below)
+    int warmup_runs;                  // Low latency: single-event runs made before PSNN_InitializeWithOptions returns
+    int lock_process_memory;          // Low latency, opt-in: also lock the whole process and keep the C heap (see below)
+};
+
+// Special values of PSNN_InitOptions::pin_cpu
+#define PSNN_PIN_CURRENT_CPU -1       // The CPU each thread is running on when it is pinned (default)
+#define PSNN_PIN_NONE -2              // Leave threads unpinned
+
+// Page backing of the low-latency pool, in PSNN_LatencyStats::pool_pages
+#define PSNN_POOL_SMALL_PAGES 0
+#define PSNN_POOL_TRANSPARENT_HUGE_PAGES 1  // Transparent huge pages requested (Linux)
+#define PSNN_POOL_HUGE_PAGES 2              // Reserved huge pages (Linux) or large pages (Windows)
+
+// State of the low-latency setup, read by PSNN_GetLatencyStats
+struct PSNN_LatencyStats {
+    int low_latency;                  // Non-zero if the session was initialised with low_latency
+    int pool_pages;                   // PSNN_POOL_* page backing of the pool
+    int pool_locked;                  // Non-zero if the pool is locked in RAM
+    int process_locked;               // Non-zero if lock_process_memory locked every page mapped by the end of warm-up
+    int pinned_cpu;                   // CPU the initialising thread was pinned to during set-up, -1 if none
+    int pinned_threads;               // Threads left pinned (pin_callers): the initialising one and each single-event caller
+    size_t pool_bytes;                // Size of the pool
+    size_t pool_used_bytes;           // Pool memory ORT has taken so far
+    unsigned long long predict_page_faults;        // Page faults callers took inside PSNN_Predict / PSNN_PredictSparse since warm-up
+    unsigned long long allocations_after_warmup;   // ORT allocations since warm-up that needed new memory
+    unsigned long long pool_overflows;             // ORT allocations the full pool passed to the heap
+};
+
+// Resident memory reported by PSNN_GetMemoryStats
+struct PSNN_MemoryStats {
+    size_t process_resident_bytes;    // Current resident set size of the process
+    size_t init_resident_delta_bytes; // Growth of process_resident_bytes across the current session's initialisation (see below)
+    size_t live_sessions;             // Sessions alive in this process
+};
+
+// Options for PSNN_EnableTracing; fill with PSNN_DefaultTraceOptions first
+struct PSNN_TraceOptions {
+    unsigned int struct_size;         // sizeof(PSNN_TraceOptions), set by PSNN_DefaultTraceOptions
+    double sample_rate;               // Fraction of calls traced (1.0 default, e.g. 0.01 in production)
+    size_t ring_spans;                // Spans kept per thread before the oldest are overwritten
+    int ort_profiling;                // Non-zero: also run ORT's profiler (every Run, not sampled)
+};
+
+// Request classes for PSNN_PredictRequest; interactive requests are served before bulk ones
+#define PSNN_PRIORITY_INTERACTIVE 0
+#define PSNN_PRIORITY_BULK 1
+
+// Status codes returned by PSNN_PredictRequest
+#define PSNN_STATUS_OK 0
+#define PSNN_STATUS_ERROR 1          // Invalid arguments, no service, or the model failed
+#define PSNN_STATUS_OVERLOADED 2     // The request's queue was full; retry later or shed the work
+#define PSNN_STATUS_EXPIRED 3        // The deadline passed before the request (or all of it) was run
+#define PSNN_STATUS_STOPPED 4        // The service was stopped before the request was run
+
+// Options for PSNN_StartService; fill with PSNN_DefaultServiceOptions first
+struct PSNN_ServiceOptions {
+    unsigned int struct_size;         // sizeof(PSNN_ServiceOptions), set by PSNN_DefaultServiceOptions
+    size_t interactive_queue_capacity;  // Interactive requests that may wait before the service reports overload
+    size_t bulk_queue_capacity;       // Bulk requests that may wait before the service reports overload
+    int n_threads;                    // Worker threads, 0 for all cores
+    size_t tile_rows;                 // Rows run per step of a multi-row request, 0 = cache-sized default
+};
+
+// Per-request options for PSNN_PredictRequest; fill with PSNN_DefaultRequestOptions first
+struct PSNN_RequestOptions {
+    unsigned int struct_size;         // sizeof(PSNN_RequestOptions), set by PSNN_DefaultRequestOptions
+    int priority;                     // PSNN_PRIORITY_INTERACTIVE (default) or PSNN_PRIORITY_BULK
+    double deadline_ms;               // Give up if not started within this many ms of the call, 0 = no deadline
+};
+
+// Counters reported by PSNN_GetServiceStats, indexed by priority
+struct PSNN_ServiceStats {
+    unsigned long long completed[2];
+    unsigned long long expired[2];
+    unsigned long long rejected[2];   // Returned PSNN_STATUS_OVERLOADED
+    unsigned long long failed[2];
+    size_t queued[2];                 // Waiting or partly run at the time of the call
+};
+
+// Options for PSNN_EnableDriftMonitor; fill with PSNN_DefaultDriftOptions first
+struct PSNN_DriftOptions {
+    unsigned int struct_size;         // sizeof(PSNN_DriftOptions), set by PSNN_DefaultDriftOptions
+    double max_mean_shift;            // Flag a feature whose live mean moves more training standard deviations than this
+    double max_variance_ratio;        // ... or whose live / training variance is above this or below its inverse
+    double max_zeroed_fraction;       // ... or whose zeroed or non-finite values exceed this fraction of events
+    unsigned long long min_events;    // Events seen before any feature is flagged
+    unsigned long long merge_rows;    // Rows a thread accumulates before merging into the shared totals
+};
+
+// Number of model input features covered by a drift report
+#define PSNN_KEPT_FEATURES 96
+
+// One feature of a drift report
+struct PSNN_DriftFeature {
+    int feature;                      // Canonical feature index (see FEATURE_NAMES in PSNN_features.h)
+    double mean_shift;                // Live mean - training mean, in training standard deviations
+    double variance_ratio;            // Live variance / training variance
+    unsigned long long zeroed;        // Values standardisation set to 0 (non-finite, or a constant feature off its value)
+    unsigned long long non_finite;    // Non-finite values passed to the model by PSNN_Predict
+    int flagged;                      // Non-zero if the feature has drifted past a threshold
+};
+
+// Drift of the inputs since PSNN_EnableDriftMonitor, read by PSNN_GetDriftReport
+struct PSNN_DriftReport {
+    unsigned long long events;
+    int n_flagged;
+    PSNN_DriftFeature features[PSNN_KEPT_FEATURES];  // In model input order
+};
+
+// Maximum number of thresholds in a run summary
+#define PSNN_SUMMARY_MAX_THRESHOLDS 16
+
+// Aggregates read from a run summary by PSNN_SummaryGetReport
+struct PSNN_SummaryReport {
+    unsigned long long events;                    // Events added to the summary
+    unsigned long long class_counts[3];           // Events by predicted class
+    float confidence_quantiles[3][5];             // 5th/25th/50th/75th/95th percentile confidence, by predicted class
+    int n_thresholds;
+    double thresholds[PSNN_SUMMARY_MAX_THRESHOLDS];
+    unsigned long long above_threshold[3][PSNN_SUMMARY_MAX_THRESHOLDS];  // Events with P(class) >= threshold
+};
+
+// Opaque streaming summary of many predictions (see PSNN_SummaryCreate)
+struct PSNN_Summary;
+
+// Connection to a resident PSNN server started with PSNN --serve-shm (see PSNN_ShmConnect)
+struct PSNN_ShmClient;
+
+// Identity of an RDP event: the alignment, the sequence triplet and the scan window
+struct PSNN_EventId {
+    unsigned int alignment;           // Alignment number
+    unsigned int sequences[3];        // Sequence numbers of the triplet
+    unsigned int window;              // Window of the scan the event was found in
+};
+
+// One event's result as held in a result store
+struct PSNN_StoredResult {
+    PSNN_EventId id;
+    float class_probabilities[3];
+    int predicted_class;
+};
+
+// Read-only, memory-mapped result store indexed by event ID (see PSNN_ResultStoreOpen)
+struct PSNN_ResultStore;
+
 // C interface for compatibility
 #ifdef __cplusplus
 extern "C" {
@@ -34,17 +192,391 @@ extern "C" {
  */
 PSNN_API bool PSNN_Initialize(const char* model_path);
 
+/**
+ * Fill an options structure with the defaults used by PSNN_Initialize
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultInitOptions(PSNN_InitOptions* options);
+
+/**
+ * Initialize the PSNN model with explicit memory settings. When many RDP
+ * workers share a node, shrinking the arena, a small first chunk and
+ * same-as-requested growth keep each session's footprint close to what it uses.
+ * Arena options and sharing apply process-wide and are fixed by the first
+ * session that uses them.
+ * 
+ * @param model_path Full path to the ONNX model file (RDP_TripleNN.onnx)
+ * @param options Options filled by PSNN_DefaultInitOptions and adjusted by the caller
+ * @return true if successful, false otherwise (including an initial_chunk_size_bytes above INT_MAX)
+ */
+PSNN_API bool PSNN_InitializeWithOptions(const char* model_path, const PSNN_InitOptions* options);
+
+/**
+ * Read the state of the low-latency setup. With low_latency, ORT's weights,
+ * arena and scratch tensors come from one pool that is mapped (on huge pages
+ * where the system has them), faulted in and locked before the session is
+ * created; the arena never shrinks; and warmup_runs single-event
+ * predictions run before PSNN_InitializeWithOptions returns. The counters
+ * start after warm-up, so any non-zero page fault or allocation count points
+ * at a latency spike.
+ *
+ * Unless pin_cpu is PSNN_PIN_NONE, the initialising thread is pinned to
+ * pin_cpu (or with PSNN_PIN_CURRENT_CPU to the CPU it is on) while the
+ * session is set up and warmed up, and gets its previous affinity back
+ * before PSNN_InitializeWithOptions returns. Setting pin_callers instead
+ * leaves it pinned, and pins each thread that calls PSNN_Predict or
+ * PSNN_PredictSparse on its first call. That is permanent: PSNN_Cleanup
+ * does not unpin them. With a fixed pin_cpu every caller shares that one
+ * CPU, so use it with one calling thread, or with PSNN_PIN_CURRENT_CPU on
+ * threads the host has already spread over CPUs.
+ *
+ * The pool belongs to the session: it is unlocked and unmapped when the
+ * session is deleted by PSNN_Cleanup or the next PSNN_InitializeWithOptions,
+ * so each low-latency session gets its own locked_pool_bytes. A session that
+ * follows one with arena options in the same process gets no pool (with a
+ * warning), since the tuned arena stays registered.
+ *
+ * By default only the pool is locked. Setting
+ * lock_process_memory also changes state of the whole host process, for as
+ * long as it runs: the C heap stops trimming and stops using separate
+ * mappings for large blocks (glibc), and after warm-up every page the process
+ * has mapped is locked (mlockall, Linux). PSNN_Cleanup does not undo either.
+ * 
+ * @param stats Structure to fill
+ * @return true if successful, false if no model is loaded
+ */
+PSNN_API bool PSNN_GetLatencyStats(PSNN_LatencyStats* stats);
+
 /**
  * Process input data and return predictions
  * 
  * @param names Array of feature names (must match expected features)
  * @param values Array of feature values corresponding to the names
- * @param num_features Number of features in the arrays (should be 117)
+ * @param num_features Number of features in the arrays: all 120 raw features (FEATURE_COUNT); the
+ *                     24 the preprocessing plan drops are removed, leaving the model's 96 inputs
  * @param result Pointer to PredictionResult structure to receive output
  * @return true if successful, false otherwise
  */
 PSNN_API bool PSNN_Predict(const char** names, const double* values, int num_features, PredictionResult* result);
 
+/**
+ * Process a sparse event and return predictions. Features that are not listed
+ * are taken to be 0, which is most of an RDP event (RCompat*, Consensus*, ...).
+ * Only the listed features are standardised; the rest come from a precomputed
+ * standardised zero row.
+ * 
+ * @param indices Feature indices in canonical order (0-119, see FEATURE_NAMES in PSNN_features.h)
+ * @param values Feature values corresponding to the indices
+ * @param nnz Number of index/value pairs
+ * @param result Pointer to PredictionResult structure to receive output
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_PredictSparse(const int* indices, const double* values, int nnz, PredictionResult* result);
+
+/**
+ * Process many dense events in one call. Rows are split into cache-sized
+ * tiles that are standardised and run as batches on a work-stealing thread
+ * pool owned by the current session (created on the first call). Results are
+ * written in input order. Concurrent calls are serialised.
+ * 
+ * @param values n_rows * 120 raw feature values, each row in canonical order
+ *               (see FEATURE_NAMES in PSNN_features.h)
+ * @param n_rows Number of events
+ * @param results Array of n_rows PredictionResult structures to receive output
+ * @param n_threads Maximum number of threads to use, 0 for all cores
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_PredictBulk(const double* values, size_t n_rows, PredictionResult* results, int n_threads);
+
+/**
+ * Fill a service options structure with defaults
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultServiceOptions(PSNN_ServiceOptions* options);
+
+/**
+ * Start the prediction service on the current session (replacing a running
+ * one). The service keeps one bounded queue per priority class and worker
+ * threads that always take their next tile of work from the interactive queue
+ * first, so interactive users are not stuck behind bulk scans.
+ * Must be called after PSNN_Initialize; re-initializing stops the service.
+ * 
+ * @param options Options filled by PSNN_DefaultServiceOptions and adjusted by the caller
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_StartService(const PSNN_ServiceOptions* options);
+
+/**
+ * Fill a request options structure with defaults (interactive, no deadline)
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultRequestOptions(PSNN_RequestOptions* options);
+
+/**
+ * Predict one or more dense events through the prediction service, waiting
+ * for the result. A request whose queue is full is turned away at once with
+ * PSNN_STATUS_OVERLOADED rather than queued; one whose deadline passes while
+ * it waits is dropped with PSNN_STATUS_EXPIRED. Multi-row requests are run
+ * tile by tile, and no further tiles are started after the deadline.
+ * 
+ * @param values n_rows * 120 raw feature values, each row in canonical order
+ *               (see FEATURE_NAMES in PSNN_features.h)
+ * @param n_rows Number of events
+ * @param results Array of n_rows PredictionResult structures to receive output
+ * @param options Priority and deadline, or NULL for the defaults
+ * @return A PSNN_STATUS_* code
+ */
+PSNN_API int PSNN_PredictRequest(const double* values, size_t n_rows, PredictionResult* results,
+                                 const PSNN_RequestOptions* options);
+
+/**
+ * Report the service's counters and queue depths
+ * 
+ * @param stats Pointer to PSNN_ServiceStats structure to receive output
+ * @return true if successful, false if no service is running
+ */
+PSNN_API bool PSNN_GetServiceStats(PSNN_ServiceStats* stats);
+
+/**
+ * Stop the prediction service. Running tiles finish; queued requests return
+ * PSNN_STATUS_STOPPED. Safe to call while other threads are in
+ * PSNN_PredictRequest: it returns once they have all left it, and later
+ * requests fail with PSNN_STATUS_ERROR.
+ */
+PSNN_API void PSNN_StopService();
+
+/**
+ * Create an empty run summary: class counts, confidence quantiles per class
+ * (from fixed 0.001-wide histograms) and the number of events whose class
+ * probability reaches each threshold
+ * 
+ * @param thresholds Array of probability thresholds
+ * @param n_thresholds Number of thresholds (0 to PSNN_SUMMARY_MAX_THRESHOLDS)
+ * @return New summary to be released with PSNN_SummaryFree, or NULL on invalid arguments
+ */
+PSNN_API PSNN_Summary* PSNN_SummaryCreate(const double* thresholds, int n_thresholds);
+
+/**
+ * Like PSNN_PredictBulk, but only adds the events to a summary; no per-event
+ * results are produced. Each pool thread keeps its own partial summary, and
+ * the partials are merged when the call ends. Call repeatedly to stream a
+ * run through in chunks.
+ * 
+ * @param values n_rows * 120 raw feature values, each row in canonical order
+ * @param n_rows Number of events
+ * @param summary Summary from PSNN_SummaryCreate
+ * @param n_threads Maximum number of threads to use, 0 for all cores
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_PredictBulkSummary(const double* values, size_t n_rows, PSNN_Summary* summary, int n_threads);
+
+/**
+ * Read the aggregates of a summary
+ * 
+ * @param summary Summary from PSNN_SummaryCreate
+ * @param report Pointer to PSNN_SummaryReport structure to receive output
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_SummaryGetReport(const PSNN_Summary* summary, PSNN_SummaryReport* report);
+
+/**
+ * Write a summary as a compact CSV report (same layout as PSNN --summary)
+ * 
+ * @param summary Summary from PSNN_SummaryCreate
+ * @param path Output file path
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_SummaryWrite(const PSNN_Summary* summary, const char* path);
+
+/**
+ * Release a summary
+ * 
+ * @param summary Summary from PSNN_SummaryCreate, or NULL
+ */
+PSNN_API void PSNN_SummaryFree(PSNN_Summary* summary);
+
+/**
+ * Connect to a resident PSNN server over shared memory. The server process
+ * (PSNN --serve-shm NAME) owns the model; this call does not need
+ * PSNN_Initialize. Linux only.
+ * 
+ * @param name Name given to --serve-shm, e.g. "/psnn"
+ * @return Connection to be released with PSNN_ShmDisconnect, or NULL if no server is running
+ */
+PSNN_API PSNN_ShmClient* PSNN_ShmConnect(const char* name);
+
+/**
+ * Predict one event through the server. Requests and responses travel through
+ * fixed-size slots of a shared ring with futex wakeups, so there is no file
+ * I/O or serialisation. Any number of threads and processes may share a server,
+ * and threads may share one connection.
+ * 
+ * @param client Connection from PSNN_ShmConnect
+ * @param values 120 raw feature values in canonical order (see FEATURE_NAMES in PSNN_features.h)
+ * @param result Pointer to PredictionResult structure to receive output
+ * @return true if successful, false if the server failed the request or has stopped
+ */
+PSNN_API bool PSNN_ShmPredict(PSNN_ShmClient* client, const double* values, PredictionResult* result);
+
+/**
+ * Close a connection
+ * 
+ * @param client Connection from PSNN_ShmConnect, or NULL
+ */
+PSNN_API void PSNN_ShmDisconnect(PSNN_ShmClient* client);
+
+/**
+ * Fill a tracing options structure with defaults
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultTraceOptions(PSNN_TraceOptions* options);
+
+/**
+ * Turn on stage tracing. Sampled PSNN_Predict / PSNN_PredictSparse calls and
+ * PSNN_PredictBulk tiles record parse, drop, standardise, tensor build,
+ * Session::Run and extract spans into per-thread lock-free ring buffers.
+ * Call before PSNN_Initialize for ort_profiling to apply to the session.
+ * 
+ * @param options Options filled by PSNN_DefaultTraceOptions and adjusted by the caller
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_EnableTracing(const PSNN_TraceOptions* options);
+
+/**
+ * Write the recorded spans as a Chrome trace / Perfetto JSON file. With
+ * ort_profiling, ORT's profiler is stopped and its kernel events are merged
+ * onto the same timeline. Call once, when the run is over.
+ * 
+ * @param path Output file path
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_WriteTrace(const char* path);
+
+/**
+ * Fill a drift monitor options structure with defaults
+ * 
+ * @param options Structure to fill
+ */
+PSNN_API void PSNN_DefaultDriftOptions(PSNN_DriftOptions* options);
+
+/**
+ * Turn on (or reset) input drift monitoring. Every event standardised by
+ * PSNN_Predict, PSNN_PredictSparse, PSNN_PredictBulk, PSNN_PredictBulkSummary
+ * and the prediction service is added to per-feature running means and
+ * variances, compared with the training statistics (MEANS / STD_DEV).
+ * Threads accumulate separately and merge every merge_rows rows, at which
+ * point newly drifted features are reported once on stderr.
+ * 
+ * @param options Options filled by PSNN_DefaultDriftOptions and adjusted by the caller
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_EnableDriftMonitor(const PSNN_DriftOptions* options);
+
+/**
+ * Read the drift of every input feature so far
+ * 
+ * @param report Pointer to PSNN_DriftReport structure to receive output
+ * @return true if successful, false if the monitor is off
+ */
+PSNN_API bool PSNN_GetDriftReport(PSNN_DriftReport* report);
+
+/**
+ * Write the drift report as CSV, one line per feature (same layout as PSNN --drift)
+ * 
+ * @param path Output file path
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_WriteDriftReport(const char* path);
+
+/**
+ * Start recording every PSNN_Predict call: its arrival time, feature names,
+ * values, result and latency are appended to a compact binary file (see
+ * PSNN_record.h) for replay with psnn_replay. Names are written once per
+ * distinct name list, not per call. Replaces a recording in progress.
+ * 
+ * @param path Output file path (truncated)
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_StartRecording(const char* path);
+
+/**
+ * Stop recording and close the file
+ * 
+ * @return true if every record was written, false otherwise
+ */
+PSNN_API bool PSNN_StopRecording();
+
+/**
+ * Write results as a result store: one file holding the results and an
+ * open-addressing hash index on event ID (the format of PSNN --store, see
+ * PSNN_store.h). An existing store is replaced atomically, so processes that
+ * have it open keep reading the old one. Does not need PSNN_Initialize.
+ * 
+ * @param path Output file path
+ * @param ids n_rows event IDs
+ * @param results n_rows results, e.g. from PSNN_PredictBulk
+ * @param n_rows Number of events
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_ResultStoreWrite(const char* path, const PSNN_EventId* ids, const PredictionResult* results,
+                                    size_t n_rows);
+
+/**
+ * Map a result store read-only. Any number of processes may open the same
+ * store; they share one copy of it in the page cache. Does not need
+ * PSNN_Initialize.
+ * 
+ * @param path Store file path
+ * @return Store to be released with PSNN_ResultStoreClose, or NULL if it cannot be opened
+ */
+PSNN_API PSNN_ResultStore* PSNN_ResultStoreOpen(const char* path);
+
+/**
+ * Look up the result of one event. The ID's hash picks a slot of the index,
+ * which is at most half full, so a lookup reads a slot or two and the record;
+ * nothing is copied. Safe to call from several threads at once.
+ * 
+ * @param store Store from PSNN_ResultStoreOpen
+ * @param id Event ID
+ * @return The event's result inside the store, valid until PSNN_ResultStoreClose,
+ *         or NULL if the store does not hold the event
+ */
+PSNN_API const PSNN_StoredResult* PSNN_LookupResult(const PSNN_ResultStore* store, const PSNN_EventId* id);
+
+/**
+ * @param store Store from PSNN_ResultStoreOpen
+ * @return Number of events in the store
+ */
+PSNN_API size_t PSNN_ResultStoreSize(const PSNN_ResultStore* store);
+
+/**
+ * Unmap a result store
+ * 
+ * @param store Store from PSNN_ResultStoreOpen, or NULL
+ */
+PSNN_API void PSNN_ResultStoreClose(PSNN_ResultStore* store);
+
+/**
+ * Report resident memory of the process and its growth while the current
+ * session was initialised
+ * 
+ * init_resident_delta_bytes is the process's resident set after
+ * PSNN_InitializeWithOptions created the session and ran it once, minus the
+ * set before. It is an approximation of the session's footprint, not a
+ * measure of it: memory other threads of the host touched meanwhile is
+ * included, and so is process-wide state set up by the first session only
+ * (the shared Env, a tuned arena, the low-latency pool). Compare sessions by
+ * process_resident_bytes with one session per process for exact figures.
+ * 
+ * @param stats Pointer to PSNN_MemoryStats structure to receive output
+ * @return true if successful, false otherwise
+ */
+PSNN_API bool PSNN_GetMemoryStats(PSNN_MemoryStats* stats);
+
 /**
  * Cleanup resources
  * Should be called when done using the DLL
@@ -0,0 +1,295 @@
+// PSNN_drift.cpp - Online monitoring of the inputs against the training statistics
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "PSNN_drift.h"
+
+void initDrift(DriftStats& stats) {
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Sums of a block of standardised rows, taken relative to a per-feature shift
+ * (the mean so far) so that the variance survives the subtraction when it is
+ * folded into DriftStats. Adding rows is one branch-free pass with the feature
+ * loop innermost, so it vectorises; the Welford merge is paid once per block.
+ */
+struct DriftBlock {
+    uint64_t events;
+    double shift[KEPT_FEATURE_COUNT];
+    double count[KEPT_FEATURE_COUNT];
+    double sum[KEPT_FEATURE_COUNT];
+    double sum_sq[KEPT_FEATURE_COUNT];
+    uint64_t zeroed[KEPT_FEATURE_COUNT];
+};
+
+static void startBlock(DriftBlock& block, const DriftStats& around) {
+    std::memset(&block, 0, sizeof(block));
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        block.shift[k] = around.mean[k];
+    }
+}
+
+// Empty a block, shifting the next one by the mean of the rows it held
+static void restartBlock(DriftBlock& block) {
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        double shift = block.count[k] > 0.0 ? block.shift[k] + block.sum[k] / block.count[k] : block.shift[k];
+        block.shift[k] = shift;
+        block.count[k] = 0.0;
+        block.sum[k] = 0.0;
+        block.sum_sq[k] = 0.0;
+        block.zeroed[k] = 0;
+    }
+    block.events = 0;
+}
+
+static void addBlockRows(DriftBlock& block, const float* standardised, size_t n_rows, const uint32_t* zeroed) {
+    for (size_t r = 0; r < n_rows; r++) {
+        const float* row = standardised + r * KEPT_FEATURE_COUNT;
+        for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+            // Non-finite values are masked out of the sums on the bit pattern: a floating-point
+            // comparison may trap, and would keep the loop from being vectorised
+            uint32_t bits;
+            std::memcpy(&bits, row + k, sizeof(bits));
+            uint32_t finite = (bits & 0x7f800000u) != 0x7f800000u;
+            uint32_t masked = bits & (0u - finite);
+            float v;
+            std::memcpy(&v, &masked, sizeof(v));
+            double weight = static_cast<double>(static_cast<int32_t>(finite));
+            double d = (static_cast<double>(v) - block.shift[k]) * weight;
+            block.count[k] += weight;
+            block.sum[k] += d;
+            block.sum_sq[k] += d * d;
+        }
+    }
+    block.events += n_rows;
+    if (zeroed) {
+        for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+            block.zeroed[k] += zeroed[k];
+        }
+    }
+}
+
+// Chan et al.'s pairwise update: combine feature k of stats with count_b values of the given mean and m2
+static void mergeMoments(DriftStats& stats, size_t k, double count_b, double mean_b, double m2_b) {
+    if (count_b <= 0.0) {
+        return;
+    }
+    double count_a = static_cast<double>(stats.count[k]);
+    double n = count_a + count_b;
+    double delta = mean_b - stats.mean[k];
+    stats.mean[k] += delta * count_b / n;
+    stats.m2[k] += m2_b + delta * delta * count_a * count_b / n;
+    stats.count[k] += static_cast<uint64_t>(count_b);
+}
+
+static void mergeBlock(DriftStats& stats, const DriftBlock& block) {
+    stats.events += block.events;
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        double n = block.count[k];
+        if (n > 0.0) {
+            double mean = block.sum[k] / n;
+            mergeMoments(stats, k, n, block.shift[k] + mean, std::max(0.0, block.sum_sq[k] - block.sum[k] * mean));
+        }
+        stats.zeroed[k] += block.zeroed[k];
+        stats.non_finite[k] += block.events - static_cast<uint64_t>(n);
+    }
+}
+
+void addDriftRows(DriftStats& stats, const float* standardised, size_t n_rows, const uint32_t* zeroed) {
+    if (n_rows == 0) {
+        return;
+    }
+    DriftBlock block;
+    startBlock(block, stats);
+    addBlockRows(block, standardised, n_rows, zeroed);
+    mergeBlock(stats, block);
+}
+
+void mergeDrift(DriftStats& into, const DriftStats& from) {
+    into.events += from.events;
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        mergeMoments(into, k, static_cast<double>(from.count[k]), from.mean[k], from.m2[k]);
+        into.zeroed[k] += from.zeroed[k];
+        into.non_finite[k] += from.non_finite[k];
+    }
+}
+
+size_t checkDrift(const DriftStats& stats, const DriftOptions& options, std::vector<DriftFeature>& features) {
+    const auto& kept = keptFeatureIndices();
+    features.assign(KEPT_FEATURE_COUNT, DriftFeature());
+    bool enough = stats.events > 0 && stats.events >= options.min_events;
+    size_t flagged = 0;
+
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        DriftFeature& f = features[k];
+        f.feature = kept[k];
+        f.mean_shift = stats.count[k] > 0 ? stats.mean[k] : 0.0;
+        f.variance_ratio = stats.count[k] > 1 ? stats.m2[k] / static_cast<double>(stats.count[k] - 1) : 0.0;
+        f.zeroed = stats.zeroed[k];
+        f.non_finite = stats.non_finite[k];
+        f.flagged = false;
+        if (!enough) {
+            continue;
+        }
+
+        // A constant training feature always standardises to 0, so only its zeroed count means anything
+        bool constant = PLAN_SCALE[k] == 0.0;
+        double lost = static_cast<double>(f.zeroed + f.non_finite) / static_cast<double>(stats.events);
+        f.flagged = lost > options.max_zeroed_fraction ||
+                    (!constant && stats.count[k] > 1 &&
+                     (std::fabs(f.mean_shift) > options.max_mean_shift ||
+                      f.variance_ratio > options.max_variance_ratio ||
+                      f.variance_ratio * options.max_variance_ratio < 1.0));
+        if (f.flagged) {
+            flagged++;
+        }
+    }
+    return flagged;
+}
+
+size_t warnDrift(const DriftStats& stats, const DriftOptions& options, std::vector<bool>& reported) {
+    std::vector<DriftFeature> features;
+    if (checkDrift(stats, options, features) == 0) {
+        return 0;
+    }
+    reported.resize(KEPT_FEATURE_COUNT, false);
+
+    size_t added = 0;
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        const DriftFeature& f = features[k];
+        if (!f.flagged || reported[k]) {
+            continue;
+        }
+        reported[k] = true;
+        added++;
+        std::cerr << "Warning: Input drift in " << FEATURE_NAMES[f.feature] << " after " << stats.events
+                  << " events: mean shift " << f.mean_shift << " sd, variance ratio " << f.variance_ratio
+                  << ", " << f.zeroed << " zeroed, " << f.non_finite << " non-finite" << std::endl;
+    }
+    return added;
+}
+
+int writeDriftReport(const std::string& path, const DriftStats& stats, const DriftOptions& options) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return 1;
+    }
+
+    std::vector<DriftFeature> features;
+    size_t flagged = checkDrift(stats, options, features);
+    out << "events," << stats.events << "\n";
+    out << "flagged," << flagged << "\n";
+    out << "feature,name,mean_shift,variance_ratio,zeroed,non_finite,flagged\n";
+
+    char line[256];
+    for (const DriftFeature& f : features) {
+        int len = std::snprintf(line, sizeof(line), "%zu,%s,%.6g,%.6g,%llu,%llu,%d\n", f.feature,
+                                FEATURE_NAMES[f.feature].c_str(), f.mean_shift, f.variance_ratio,
+                                static_cast<unsigned long long>(f.zeroed),
+                                static_cast<unsigned long long>(f.non_finite), f.flagged ? 1 : 0);
+        out.write(line, len);
+    }
+    return out.good() ? 0 : 1;
+}
+
+// Threads are spread over a fixed set of shards; each is only contended when
+// more threads record than there are shards
+static const size_t DRIFT_SHARDS = 16;
+
+struct alignas(64) DriftShard {
+    std::mutex mutex;
+    DriftBlock block;  // Rows added since the shard was last merged
+};
+
+struct DriftState {
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> merge_rows{1};  // options.merge_rows, read by recordDrift() without the lock
+    std::atomic<size_t> next_shard{0};
+    DriftShard shards[DRIFT_SHARDS];
+    std::mutex mutex;  // Guards options, total and reported
+    DriftOptions options;
+    DriftStats total;
+    std::vector<bool> reported;
+};
+
+static DriftState& driftState() {
+    static DriftState state;
+    return state;
+}
+
+static thread_local size_t t_shard = DRIFT_SHARDS;
+
+void enableDriftMonitor(const DriftOptions& options) {
+    DriftState& state = driftState();
+    state.enabled.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.options = options;
+        state.options.merge_rows = std::max<uint64_t>(1, options.merge_rows);
+        state.merge_rows.store(state.options.merge_rows, std::memory_order_relaxed);
+        initDrift(state.total);
+        state.reported.assign(KEPT_FEATURE_COUNT, false);
+    }
+    for (DriftShard& shard : state.shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::memset(&shard.block, 0, sizeof(shard.block));
+    }
+    state.enabled.store(true, std::memory_order_release);
+}
+
+bool driftMonitorEnabled() {
+    return driftState().enabled.load(std::memory_order_acquire);
+}
+
+DriftOptions driftOptions() {
+    DriftState& state = driftState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.options;
+}
+
+void recordDrift(const float* standardised, size_t n_rows, const uint32_t* zeroed) {
+    DriftState& state = driftState();
+    if (n_rows == 0 || !state.enabled.load(std::memory_order_acquire)) {
+        return;
+    }
+    if (t_shard == DRIFT_SHARDS) {
+        t_shard = state.next_shard.fetch_add(1, std::memory_order_relaxed) % DRIFT_SHARDS;
+    }
+
+    // A full block is handed over by copy so the shard lock is never held with the totals lock
+    static thread_local DriftBlock merging;
+    DriftShard& shard = state.shards[t_shard];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        addBlockRows(shard.block, standardised, n_rows, zeroed);
+        if (shard.block.events < state.merge_rows.load(std::memory_order_relaxed)) {
+            return;
+        }
+        merging = shard.block;
+        restartBlock(shard.block);
+    }
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    mergeBlock(state.total, merging);
+    warnDrift(state.total, state.options, state.reported);
+}
+
+void driftSnapshot(DriftStats& stats) {
+    DriftState& state = driftState();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        stats = state.total;
+    }
+    for (DriftShard& shard : state.shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        mergeBlock(stats, shard.block);
+    }
+}
@@ -0,0 +1,141 @@
+// PSNN_drift.h - Online monitoring of the inputs against the training statistics
+#ifndef PSNN_DRIFT_H
+#define PSNN_DRIFT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "PSNN_features.h"
+
+// When a feature counts as drifted
+struct DriftOptions {
+    double max_mean_shift = 0.5;        // |live mean - training mean|, in training standard deviations
+    double max_variance_ratio = 4.0;    // Live / training variance above this (or below its inverse)
+    double max_zeroed_fraction = 1e-3;  // Values zeroed by standardisation or non-finite, per value seen
+    uint64_t min_events = 10000;        // Events seen before any feature is flagged
+    uint64_t merge_rows = 4096;         // Rows a thread accumulates before merging into the shared totals
+};
+
+/**
+ * Per-feature moments of standardised inputs (Welford mean and sum of squared
+ * deviations). Because the rows are standardised with MEANS and STD_DEV, a
+ * feature that still follows the training distribution has mean 0 and
+ * variance 1. Plain data, so partial stats can live in a shared mapping or a
+ * checkpoint; partials combine exactly with mergeDrift().
+ */
+struct DriftStats {
+    uint64_t events;
+    uint64_t count[KEPT_FEATURE_COUNT];       // Finite values seen per feature
+    double mean[KEPT_FEATURE_COUNT];
+    double m2[KEPT_FEATURE_COUNT];
+    uint64_t zeroed[KEPT_FEATURE_COUNT];      // Values standardisation set to 0 (non-finite result or zero std)
+    uint64_t non_finite[KEPT_FEATURE_COUNT];  // Non-finite values that reached the model (left out of the moments)
+};
+
+// One feature's comparison with the training statistics
+struct DriftFeature {
+    size_t feature;         // Index into FEATURE_NAMES
+    double mean_shift;      // Live mean of the standardised values
+    double variance_ratio;  // Live variance of the standardised values
+    uint64_t zeroed;
+    uint64_t non_finite;
+    bool flagged;
+};
+
+/**
+ * Reset stats.
+ *
+ * @param stats Stats to reset
+ */
+void initDrift(DriftStats& stats);
+
+/**
+ * Add a block of standardised rows. The block's sums are taken in one
+ * vectorised pass over the contiguous rows and then merged into stats.
+ *
+ * @param stats Stats to update
+ * @param standardised n_rows * KEPT_FEATURE_COUNT values
+ * @param n_rows Number of rows
+ * @param zeroed KEPT_FEATURE_COUNT counts of values zeroed while standardising the rows, or null
+ */
+void addDriftRows(DriftStats& stats, const float* standardised, size_t n_rows, const uint32_t* zeroed);
+
+/**
+ * Add another partial's moments and counts into this one.
+ *
+ * @param into Stats to update
+ * @param from Stats to add
+ */
+void mergeDrift(DriftStats& into, const DriftStats& from);
+
+/**
+ * Compare every feature with the training statistics.
+ *
+ * @param stats Stats to check
+ * @param options Thresholds
+ * @param features Receives KEPT_FEATURE_COUNT entries in model input order
+ * @return Number of flagged features (always 0 before min_events)
+ */
+size_t checkDrift(const DriftStats& stats, const DriftOptions& options, std::vector<DriftFeature>& features);
+
+/**
+ * Print a warning for each flagged feature that has not been reported yet.
+ *
+ * @param stats Stats to check
+ * @param options Thresholds
+ * @param reported KEPT_FEATURE_COUNT flags, updated with the features warned about
+ * @return Number of features newly flagged
+ */
+size_t warnDrift(const DriftStats& stats, const DriftOptions& options, std::vector<bool>& reported);
+
+/**
+ * Write a CSV report with one line per feature.
+ *
+ * @param path Output file path
+ * @param stats Stats to report
+ * @param options Thresholds
+ * @return 0 on success, non-zero on failure
+ */
+int writeDriftReport(const std::string& path, const DriftStats& stats, const DriftOptions& options);
+
+/**
+ * Turn on the process-wide monitor (or reset it) for recordDrift(). Calling
+ * threads accumulate into their own shard without contention; a shard is
+ * merged into the shared totals every merge_rows rows, and newly flagged
+ * features are reported on stderr at that point.
+ *
+ * @param options Thresholds and merge interval
+ */
+void enableDriftMonitor(const DriftOptions& options);
+
+/**
+ * @return true if enableDriftMonitor() has been called
+ */
+bool driftMonitorEnabled();
+
+/**
+ * @return A copy of the options passed to enableDriftMonitor(), which may be
+ *         called again while other threads record
+ */
+DriftOptions driftOptions();
+
+/**
+ * Record standardised rows with the process-wide monitor; a no-op while it is off.
+ *
+ * @param standardised n_rows * KEPT_FEATURE_COUNT values
+ * @param n_rows Number of rows
+ * @param zeroed KEPT_FEATURE_COUNT counts of values zeroed while standardising the rows, or null
+ */
+void recordDrift(const float* standardised, size_t n_rows, const uint32_t* zeroed);
+
+/**
+ * Everything recorded so far, including rows not yet merged. Rows a thread is
+ * merging at the moment of the call may be missing.
+ *
+ * @param stats Receives the stats
+ */
+void driftSnapshot(DriftStats& stats);
+
+#endif // PSNN_DRIFT_H
@@ -0,0 +1,165 @@
+// PSNN_features.h - Feature schema and standardisation parameters shared by all PSNN binaries
+#ifndef PSNN_FEATURES_H
+#define PSNN_FEATURES_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+// Generated at build time from PSNN_params.csv by psnn_plan_gen
+#include "PSNN_plan.h"
+
+// Number of raw features RDP produces per event
+static const size_t FEATURE_COUNT = PLAN_FEATURE_COUNT;
+
+// Number of features left after dropping the no-variance ones (model input width)
+static const size_t KEPT_FEATURE_COUNT = PLAN_KEPT_COUNT;
+
+// Number of recombinant classes predicted by the model
+static const size_t NUM_CLASSES = PLAN_NUM_CLASSES;
+
+// Canonical order of the raw features, as written by RDP into sharedData.txt
+inline const std::vector<std::string> FEATURE_NAMES(PLAN_FEATURE_NAMES.begin(), PLAN_FEATURE_NAMES.end());
+
+// Standard deviations and means of the kept features, in kept order
+inline constexpr const std::array<double, KEPT_FEATURE_COUNT>& STD_DEV = PLAN_STD_DEV;
+inline constexpr const std::array<double, KEPT_FEATURE_COUNT>& MEANS = PLAN_MEANS;
+
+/**
+ * Look up the canonical index of a raw feature.
+ *
+ * @param name Feature name as written by RDP
+ * @return Index into FEATURE_NAMES, or -1 if the name is unknown
+ */
+inline int featureIndex(std::string_view name) {
+    // Keyed by views of the plan's string literals, so lookups never allocate
+    static const std::unordered_map<std::string_view, int> index = [] {
+        std::unordered_map<std::string_view, int> m;
+        for (size_t i = 0; i < PLAN_FEATURE_NAMES.size(); i++) {
+            m.emplace(PLAN_FEATURE_NAMES[i], static_cast<int>(i));
+        }
+        return m;
+    }();
+
+    auto it = index.find(name);
+    return it == index.end() ? -1 : it->second;
+}
+
+/**
+ * Canonical indices of the features that survive drop(), in model input order.
+ *
+ * @return KEPT_FEATURE_COUNT indices into FEATURE_NAMES
+ */
+inline constexpr const std::array<uint16_t, KEPT_FEATURE_COUNT>& keptFeatureIndices() {
+    return PLAN_GATHER;
+}
+
+/**
+ * Position of a raw feature in the model input.
+ *
+ * @param feature Index into FEATURE_NAMES
+ * @return Index into the standardised row, or -1 if the feature is dropped
+ */
+inline int keptPosition(size_t feature) {
+    return feature < FEATURE_COUNT ? PLAN_POSITION[feature] : -1;
+}
+
+/**
+ * Whether a feature is one of those dropped before inference. Names that are
+ * not features at all are not dropped.
+ *
+ * @param name Feature name as written by RDP
+ * @return true if the feature is dropped
+ */
+inline bool isDroppedFeature(std::string_view name) {
+    int index = featureIndex(name);
+    return index >= 0 && PLAN_POSITION[static_cast<size_t>(index)] < 0;
+}
+
+/**
+ * Standardise one kept feature as drop() followed by standardise() do.
+ *
+ * @param k Index into the standardised row
+ * @param raw Raw value of the feature
+ * @return The standardised value; 0 for a constant feature, and possibly non-finite
+ */
+inline double standardiseValue(size_t k, double raw) {
+    return PLAN_SCALE[k] == 0.0 ? 0.0 : raw * PLAN_SCALE[k] + PLAN_OFFSET[k];
+}
+
+/**
+ * Drop and standardise one raw event given in canonical feature order.
+ * Mirrors drop() followed by standardise(): non-finite results are set to 0.
+ *
+ * @param raw FEATURE_COUNT raw values in FEATURE_NAMES order
+ * @param out Receives KEPT_FEATURE_COUNT standardised values
+ * @param zeroed If not null, KEPT_FEATURE_COUNT counters; one is incremented for each value
+ *               set to 0 that carried information (a non-finite result, or a constant
+ *               feature away from its training value)
+ */
+inline void standardiseRow(const double* raw, float* out, uint32_t* zeroed = nullptr) {
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        double x = raw[PLAN_GATHER[k]];
+        double v = x * PLAN_SCALE[k] + PLAN_OFFSET[k];
+        if (PLAN_SCALE[k] == 0.0) {
+            v = 0.0;
+            if (zeroed && x != MEANS[k]) zeroed[k]++;
+        } else if (!std::isfinite(v)) {
+            v = 0.0;
+            if (zeroed) zeroed[k]++;
+        }
+        out[k] = static_cast<float>(v);
+    }
+}
+
+/**
+ * The standardised form of an all-zero event (-mean/std per kept feature),
+ * used as the starting point for sparse events.
+ *
+ * @return KEPT_FEATURE_COUNT values
+ */
+inline constexpr const std::array<float, KEPT_FEATURE_COUNT>& standardisedZeroRow() {
+    return PLAN_ZERO_ROW;
+}
+
+/**
+ * Standardise an event given as (feature index, value) pairs; features that are
+ * not listed are 0. Only the listed kept features cost any work.
+ *
+ * @param indices Indices into FEATURE_NAMES
+ * @param values Raw values for those features
+ * @param nnz Number of pairs
+ * @param out Receives KEPT_FEATURE_COUNT standardised values
+ * @param zeroed If not null, counters of zeroed values as for standardiseRow (listed features only)
+ * @return 0 on success, non-zero if an index is out of range
+ */
+inline int standardiseSparse(const int* indices, const double* values, size_t nnz, float* out,
+                             uint32_t* zeroed = nullptr) {
+    std::copy(PLAN_ZERO_ROW.begin(), PLAN_ZERO_ROW.end(), out);
+
+    for (size_t i = 0; i < nnz; i++) {
+        if (indices[i] < 0 || static_cast<size_t>(indices[i]) >= FEATURE_COUNT) {
+            return 1;
+        }
+        int k = PLAN_POSITION[static_cast<size_t>(indices[i])];
+        if (k < 0) {
+            continue;
+        }
+        if (PLAN_SCALE[k] == 0.0) {
+            if (zeroed && values[i] != MEANS[k]) zeroed[k]++;
+            continue;
+        }
+        double v = values[i] * PLAN_SCALE[k] + PLAN_OFFSET[k];
+        out[k] = std::isfinite(v) ? static_cast<float>(v) : 0.0f;
+        if (zeroed && !std::isfinite(v)) zeroed[k]++;
+    }
+    return 0;
+}
+
+#endif // PSNN_FEATURES_H
@@ -0,0 +1,475 @@
+// PSNN_io.cpp - Readers and writers for the PSNN event file formats
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <charconv>
+
+#include "PSNN_io.h"
+#include "PSNN_features.h"
+
+static const char BINARY_MAGIC[8] = {'P', 'S', 'N', 'N', 'E', 'V', 'T', '1'};
+
+static const char SPARSE_HEADER[] = "# PSNN sparse ";
+
+// Flush the writer buffer once it grows past this size
+static const size_t WRITE_BUFFER_BYTES = 1 << 20;
+
+bool parseEventFormat(const std::string& text, EventFormat& format) {
+    if (text == "txt" || text == "shared") {
+        format = EventFormat::SharedData;
+    } else if (text == "csv") {
+        format = EventFormat::Csv;
+    } else if (text == "bin") {
+        format = EventFormat::Binary;
+    } else if (text == "sparse") {
+        format = EventFormat::Sparse;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool eventFormatFromPath(const std::string& path, EventFormat& format) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    return parseEventFormat(path.substr(dot + 1), format);
+}
+
+const char* eventFormatExtension(EventFormat format) {
+    switch (format) {
+        case EventFormat::SharedData: return "txt";
+        case EventFormat::Csv: return "csv";
+        case EventFormat::Binary: return "bin";
+        case EventFormat::Sparse: return "sparse";
+    }
+    return "";
+}
+
+// Append the shortest round-trip representation of a value
+static void appendValue(std::string& buffer, double value) {
+    char text[32];
+    auto res = std::to_chars(text, text + sizeof(text), value);
+    buffer.append(text, res.ptr);
+}
+
+// Parse a whole field as a double
+static bool parseValue(const char* first, const char* last, double& value) {
+    while (first < last && (*first == ' ' || *first == '\t')) ++first;
+    while (last > first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) --last;
+    if (first < last && *first == '+') ++first;
+    auto res = std::from_chars(first, last, value);
+    return res.ec == std::errc() && res.ptr == last;
+}
+
+EventWriter::EventWriter() : format(EventFormat::Csv), rows_written(0) {}
+
+EventWriter::~EventWriter() {
+    if (out.is_open()) {
+        close();
+    }
+}
+
+int EventWriter::open(const std::string& path, EventFormat fmt) {
+    format = fmt;
+    rows_written = 0;
+    buffer.clear();
+
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return 1;
+    }
+
+    if (format == EventFormat::Csv) {
+        for (size_t i = 0; i < FEATURE_NAMES.size(); i++) {
+            if (i > 0) buffer += ',';
+            buffer += FEATURE_NAMES[i];
+        }
+        buffer += '\n';
+    } else if (format == EventFormat::Binary) {
+        // Row count is patched in by close()
+        BinaryEventHeader header{};
+        std::memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+        header.n_features = static_cast<uint32_t>(FEATURE_COUNT);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    } else if (format == EventFormat::Sparse) {
+        buffer += SPARSE_HEADER;
+        buffer += std::to_string(FEATURE_COUNT);
+        buffer += '\n';
+    }
+
+    return out.good() ? 0 : 1;
+}
+
+int EventWriter::write(const double* rows, size_t n_rows) {
+    if (!out.is_open()) {
+        return 1;
+    }
+
+    if (format == EventFormat::Binary) {
+        out.write(reinterpret_cast<const char*>(rows), n_rows * FEATURE_COUNT * sizeof(double));
+    } else {
+        for (size_t r = 0; r < n_rows; r++) {
+            const double* row = rows + r * FEATURE_COUNT;
+            if (format == EventFormat::Csv) {
+                for (size_t i = 0; i < FEATURE_COUNT; i++) {
+                    if (i > 0) buffer += ',';
+                    appendValue(buffer, row[i]);
+                }
+                buffer += '\n';
+            } else if (format == EventFormat::Sparse) {
+                bool first = true;
+                for (size_t i = 0; i < FEATURE_COUNT; i++) {
+                    if (row[i] == 0.0) continue;
+                    if (!first) buffer += ' ';
+                    first = false;
+                    buffer += std::to_string(i);
+                    buffer += ':';
+                    appendValue(buffer, row[i]);
+                }
+                buffer += '\n';
+            } else {
+                if (rows_written + r > 0) buffer += '\n';
+                for (size_t i = 0; i < FEATURE_COUNT; i++) {
+                    buffer += FEATURE_NAMES[i];
+                    buffer += ',';
+                    appendValue(buffer, row[i]);
+                    buffer += '\n';
+                }
+            }
+
+            if (buffer.size() >= WRITE_BUFFER_BYTES) {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+    }
+
+    rows_written += n_rows;
+    return out.good() ? 0 : 1;
+}
+
+int EventWriter::close() {
+    if (!out.is_open()) {
+        return 1;
+    }
+
+    if (!buffer.empty()) {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    if (format == EventFormat::Binary) {
+        out.seekp(offsetof(BinaryEventHeader, n_rows));
+        out.write(reinterpret_cast<const char*>(&rows_written), sizeof(rows_written));
+    }
+
+    bool ok = out.good();
+    out.close();
+    return ok ? 0 : 1;
+}
+
+EventReader::EventReader() : format(EventFormat::Csv), binary_rows_left(0), line_number(0), error(false) {}
+
+EventReader::~EventReader() {
+    close();
+}
+
+void EventReader::close() {
+    if (in.is_open()) {
+        in.close();
+    }
+}
+
+int EventReader::open(const std::string& path, EventFormat fmt) {
+    format = fmt;
+    error = false;
+    line_number = 0;
+    csv_columns.clear();
+
+    in.open(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for reading." << std::endl;
+        error = true;
+        return 1;
+    }
+
+    if (format == EventFormat::Binary) {
+        BinaryEventHeader header{};
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in || std::memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0) {
+            std::cerr << "Error: " << path << " is not a PSNN binary event file." << std::endl;
+            error = true;
+            return 1;
+        }
+        if (header.n_features != FEATURE_COUNT) {
+            std::cerr << "Error: " << path << " has " << header.n_features
+                      << " features per row, expected " << FEATURE_COUNT << "." << std::endl;
+            error = true;
+            return 1;
+        }
+        
+        // The writer fills in n_rows only when it closes the file, so check it against the file size
+        binary_rows_left = header.n_rows;
+        in.seekg(0, std::ios::end);
+        std::streamoff end = in.tellg();
+        if (end < 0) {
+            // Not seekable (a pipe): trust the header
+            in.clear();
+        } else {
+            uint64_t body_bytes = static_cast<uint64_t>(end) - sizeof(header);
+            uint64_t row_bytes = FEATURE_COUNT * sizeof(double);
+            uint64_t file_rows = body_bytes / row_bytes;
+            in.seekg(sizeof(header));
+            if (header.n_rows == 0 && body_bytes > 0) {
+                std::cerr << "Warning: " << path << " was not closed by its writer; reading the " << file_rows
+                          << " whole rows it holds." << std::endl;
+                binary_rows_left = file_rows;
+            } else if (header.n_rows != file_rows || body_bytes % row_bytes != 0) {
+                std::cerr << "Error: " << path << " header says " << header.n_rows << " rows, but the file holds "
+                          << body_bytes << " bytes of rows (" << file_rows << " whole)." << std::endl;
+                error = true;
+                return 1;
+            }
+        }
+    } else if (format == EventFormat::Csv) {
+        // Map each header column onto its canonical feature index
+        std::string line;
+        if (!std::getline(in, line)) {
+            std::cerr << "Error: " << path << " is empty." << std::endl;
+            error = true;
+            return 1;
+        }
+        line_number = 1;
+
+        std::vector<bool> seen(FEATURE_COUNT, false);
+        size_t start = 0;
+        while (start <= line.size()) {
+            size_t end = line.find(',', start);
+            if (end == std::string::npos) end = line.size();
+            std::string name = line.substr(start, end - start);
+            if (!name.empty() && name.back() == '\r') name.pop_back();
+
+            int index = featureIndex(name);
+            if (index < 0) {
+                std::cerr << "Error: Unknown feature '" << name << "' in " << path << " header." << std::endl;
+                error = true;
+                return 1;
+            }
+            seen[index] = true;
+            csv_columns.push_back(index);
+            start = end + 1;
+        }
+
+        for (size_t i = 0; i < FEATURE_COUNT; i++) {
+            if (!seen[i]) {
+                std::cerr << "Error: Feature '" << FEATURE_NAMES[i] << "' missing from " << path << " header." << std::endl;
+                error = true;
+                return 1;
+            }
+        }
+    } else if (format == EventFormat::Sparse) {
+        std::string line;
+        std::string expected = SPARSE_HEADER + std::to_string(FEATURE_COUNT);
+        if (!std::getline(in, line) || line.compare(0, expected.size(), expected) != 0) {
+            std::cerr << "Error: " << path << " is not a PSNN sparse event file with "
+                      << FEATURE_COUNT << " features." << std::endl;
+            error = true;
+            return 1;
+        }
+        line_number = 1;
+    }
+
+    return 0;
+}
+
+bool EventReader::readSparseLine(std::vector<int>& indices, std::vector<double>& values) {
+    // Every line is one event; an empty line is an all-zero event
+    std::string line;
+    if (!std::getline(in, line)) {
+        return false;
+    }
+    line_number++;
+
+    const char* p = line.data();
+    const char* end = p + line.size();
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if (p == end) break;
+
+        const char* token_end = p;
+        while (token_end < end && *token_end != ' ' && *token_end != '\t' && *token_end != '\r') ++token_end;
+        const char* colon = static_cast<const char*>(std::memchr(p, ':', token_end - p));
+
+        int index = -1;
+        double value = 0.0;
+        if (!colon || std::from_chars(p, colon, index).ptr != colon || index < 0 ||
+            static_cast<size_t>(index) >= FEATURE_COUNT || !parseValue(colon + 1, token_end, value)) {
+            std::cerr << "Error: Malformed sparse entry on line " << line_number << "." << std::endl;
+            error = true;
+            return false;
+        }
+        indices.push_back(index);
+        values.push_back(value);
+        p = token_end;
+    }
+    return true;
+}
+
+size_t EventReader::readSparse(SparseEvents& events, size_t max_rows) {
+    if (error || !in.is_open() || format != EventFormat::Sparse) {
+        return 0;
+    }
+
+    size_t n = 0;
+    while (n < max_rows && readSparseLine(events.indices, events.values)) {
+        events.row_offsets.push_back(events.indices.size());
+        n++;
+    }
+    if (error) {
+        // Drop the partially parsed row
+        events.indices.resize(events.row_offsets.back());
+        events.values.resize(events.row_offsets.back());
+        return 0;
+    }
+    return n;
+}
+
+bool EventReader::readCsvRow(double* row) {
+    std::string line;
+    do {
+        if (!std::getline(in, line)) {
+            return false;
+        }
+        line_number++;
+    } while (line.empty() || line == "\r");
+
+    const char* p = line.data();
+    const char* end = p + line.size();
+    for (size_t c = 0; c < csv_columns.size(); c++) {
+        const char* comma = c + 1 < csv_columns.size() ? static_cast<const char*>(std::memchr(p, ',', end - p)) : end;
+        if (!comma || !parseValue(p, comma, row[csv_columns[c]])) {
+            std::cerr << "Error: Malformed value in column " << (c + 1) << " on line " << line_number << "." << std::endl;
+            error = true;
+            return false;
+        }
+        p = comma + 1;
+    }
+    return true;
+}
+
+bool EventReader::readSharedDataRow(double* row) {
+    std::vector<bool> seen(FEATURE_COUNT, false);
+    size_t count = 0;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        if (line.empty()) {
+            if (count == 0) continue;  // Tolerate repeated separators
+            break;
+        }
+
+        size_t comma = line.find(',');
+        int index = comma == std::string::npos ? -1 : featureIndex(line.substr(0, comma));
+        if (index < 0 || !parseValue(line.data() + comma + 1, line.data() + line.size(), row[index])) {
+            std::cerr << "Error: Malformed line " << line_number << ": " << line << std::endl;
+            error = true;
+            return false;
+        }
+        if (!seen[index]) {
+            seen[index] = true;
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        return false;
+    }
+    if (count != FEATURE_COUNT) {
+        std::cerr << "Error: Event ending on line " << line_number << " has " << count
+                  << " of " << FEATURE_COUNT << " features." << std::endl;
+        error = true;
+        return false;
+    }
+    return true;
+}
+
+size_t EventReader::read(std::vector<double>& rows, size_t max_rows) {
+    if (error || !in.is_open()) {
+        return 0;
+    }
+
+    size_t base = rows.size();
+
+    if (format == EventFormat::Binary) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(max_rows, binary_rows_left));
+        rows.resize(base + n * FEATURE_COUNT);
+        in.read(reinterpret_cast<char*>(rows.data() + base), n * FEATURE_COUNT * sizeof(double));
+        if (static_cast<size_t>(in.gcount()) != n * FEATURE_COUNT * sizeof(double)) {
+            std::cerr << "Error: Binary event file is truncated." << std::endl;
+            rows.resize(base);
+            error = true;
+            return 0;
+        }
+        binary_rows_left -= n;
+        return n;
+    }
+
+    std::vector<int> indices;
+    std::vector<double> values;
+    size_t n = 0;
+    while (n < max_rows) {
+        rows.resize(base + (n + 1) * FEATURE_COUNT, 0.0);
+        double* row = rows.data() + base + n * FEATURE_COUNT;
+        bool ok;
+        if (format == EventFormat::Sparse) {
+            indices.clear();
+            values.clear();
+            ok = readSparseLine(indices, values);
+            for (size_t i = 0; ok && i < indices.size(); i++) {
+                row[indices[i]] = values[i];
+            }
+        } else {
+            ok = format == EventFormat::Csv ? readCsvRow(row) : readSharedDataRow(row);
+        }
+        if (!ok) {
+            rows.resize(base + n * FEATURE_COUNT);
+            break;
+        }
+        n++;
+    }
+    return error ? 0 : n;
+}
+
+int loadEvents(const std::string& path, EventFormat format, std::vector<double>& rows) {
+    EventReader reader;
+    if (reader.open(path, format) != 0) {
+        return 1;
+    }
+
+    rows.clear();
+    while (reader.read(rows, 65536) > 0) {
+    }
+    return reader.failed() ? 1 : 0;
+}
+
+int loadSparseEvents(const std::string& path, SparseEvents& events) {
+    EventReader reader;
+    if (reader.open(path, EventFormat::Sparse) != 0) {
+        return 1;
+    }
+
+    events = SparseEvents();
+    while (reader.readSparse(events, 65536) > 0) {
+    }
+    return reader.failed() ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+// PSNN_io.h - Readers and writers for the PSNN event file formats
+#ifndef PSNN_IO_H
+#define PSNN_IO_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Supported event file formats. Every format stores raw (unstandardised)
+ * feature values in the canonical FEATURE_NAMES order.
+ *
+ * SharedData: "name,value" lines as in sharedData.txt, events separated by a blank line
+ * Csv:        header row of feature names, then one event per row
+ * Binary:     BinaryEventHeader followed by row-major native doubles
+ * Sparse:     "# PSNN sparse <FEATURE_COUNT>" header, then one event per line as
+ *             space-separated "index:value" pairs of its non-zero features
+ */
+enum class EventFormat {
+    SharedData,
+    Csv,
+    Binary,
+    Sparse
+};
+
+// Events in compressed sparse row form: row r owns entries [row_offsets[r], row_offsets[r + 1])
+struct SparseEvents {
+    std::vector<uint64_t> row_offsets{0};
+    std::vector<int> indices;     // Indices into FEATURE_NAMES
+    std::vector<double> values;   // Non-zero raw values
+
+    size_t rows() const { return row_offsets.size() - 1; }
+};
+
+// Header of the binary event format
+struct BinaryEventHeader {
+    char magic[8];        // "PSNNEVT1"
+    uint32_t n_features;  // Values per row (FEATURE_COUNT)
+    uint32_t flags;       // Reserved, must be 0
+    uint64_t n_rows;      // Number of rows that follow; 0 until the writer closes the file
+};
+
+/**
+ * Parse a format name ("txt", "csv", "bin" or "sparse").
+ *
+ * @param text Format name
+ * @param format Receives the parsed format
+ * @return true if the name is known, false otherwise
+ */
+bool parseEventFormat(const std::string& text, EventFormat& format);
+
+/**
+ * Guess the format of a file from its extension (.txt, .csv, .bin or .sparse).
+ *
+ * @param path File path
+ * @param format Receives the format
+ * @return true if the extension is known, false otherwise
+ */
+bool eventFormatFromPath(const std::string& path, EventFormat& format);
+
+/**
+ * File extension (without the dot) used for a format.
+ */
+const char* eventFormatExtension(EventFormat format);
+
+/**
+ * Streaming writer for event files
+ */
+class EventWriter {
+public:
+    EventWriter();
+    ~EventWriter();
+
+    /**
+     * Create (truncate) an event file and write its header.
+     *
+     * @param path Output file path
+     * @param format Output format
+     * @return 0 on success, non-zero on failure
+     */
+    int open(const std::string& path, EventFormat format);
+
+    /**
+     * Append rows to the file.
+     *
+     * @param rows n_rows * FEATURE_COUNT raw values
+     * @param n_rows Number of rows
+     * @return 0 on success, non-zero on failure
+     */
+    int write(const double* rows, size_t n_rows);
+
+    /**
+     * Finalise the header and close the file.
+     *
+     * @return 0 on success, non-zero on failure
+     */
+    int close();
+
+private:
+    std::ofstream out;
+    EventFormat format;
+    uint64_t rows_written;
+    std::string buffer;
+};
+
+/**
+ * Streaming reader for event files
+ */
+class EventReader {
+public:
+    EventReader();
+    ~EventReader();
+
+    /**
+     * Open an event file and validate its header. A Binary file whose header
+     * row count disagrees with its size is rejected, except for a count of 0
+     * (its writer never closed it): then every whole row is read, with a
+     * warning.
+     *
+     * @param path Input file path
+     * @param format Input format
+     * @return 0 on success, non-zero on failure
+     */
+    int open(const std::string& path, EventFormat format);
+
+    /**
+     * Read up to max_rows rows, appending them to rows.
+     *
+     * @param rows Receives FEATURE_COUNT values per row read
+     * @param max_rows Maximum number of rows to read
+     * @return Number of rows read; 0 at end of file or on error (see failed())
+     */
+    size_t read(std::vector<double>& rows, size_t max_rows);
+
+    /**
+     * Read up to max_rows rows of a Sparse file without densifying them.
+     *
+     * @param events Receives the rows read (appended)
+     * @param max_rows Maximum number of rows to read
+     * @return Number of rows read; 0 at end of file or on error (see failed())
+     */
+    size_t readSparse(SparseEvents& events, size_t max_rows);
+
+    /**
+     * @return true if a parse or I/O error occurred
+     */
+    bool failed() const { return error; }
+
+    void close();
+
+private:
+    bool readSharedDataRow(double* row);
+    bool readCsvRow(double* row);
+    bool readSparseLine(std::vector<int>& indices, std::vector<double>& values);
+
+    std::ifstream in;
+    EventFormat format;
+    std::vector<int> csv_columns;  // Canonical index of each CSV column
+    uint64_t binary_rows_left;
+    uint64_t line_number;
+    bool error;
+};
+
+/**
+ * Read a whole event file into memory.
+ *
+ * @param path Input file path
+ * @param format Input format
+ * @param rows Receives n_rows * FEATURE_COUNT raw values
+ * @return 0 on success, non-zero on failure
+ */
+int loadEvents(const std::string& path, EventFormat format, std::vector<double>& rows);
+
+/**
+ * Read a whole Sparse event file into memory.
+ *
+ * @param path Input file path
+ * @param events Receives the events
+ * @return 0 on success, non-zero on failure
+ */
+int loadSparseEvents(const std::string& path, SparseEvents& events);
+
+#endif // PSNN_IO_H
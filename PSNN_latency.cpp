@@ -0,0 +1,308 @@
+// PSNN_latency.cpp - Locked, pre-faulted memory and thread placement for the low-latency path
+#include <iostream>
+#include <new>
+#include <cstring>
+#include <cerrno>
+
+#include "PSNN_latency.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Huge page size the region is rounded to and aligned on (2 MB on x86-64 and most arm64 kernels)
+static const size_t HUGE_PAGE_BYTES = 2u << 20;
+static const size_t SMALL_PAGE_BYTES = 4096;
+
+// Smallest block handed out, header included
+static const size_t MIN_CLASS = 7;
+
+LockedPool::LockedPool()
+    : base(nullptr), bytes(0), offset(0), mapping(nullptr), mapping_bytes(0), page_kind(POOL_SMALL_PAGES),
+      is_locked(false), heap_blocks(0) {
+    std::memset(free_lists, 0, sizeof(free_lists));
+}
+
+LockedPool::~LockedPool() {
+    unmap();
+}
+
+void LockedPool::unmap() {
+    if (mapping) {
+#ifdef _WIN32
+        VirtualFree(mapping, 0, MEM_RELEASE);
+#else
+        if (is_locked) munlock(base, bytes);
+        munmap(mapping, mapping_bytes);
+#endif
+    }
+    base = nullptr;
+    bytes = 0;
+    offset = 0;
+    mapping = nullptr;
+    mapping_bytes = 0;
+    page_kind = POOL_SMALL_PAGES;
+    is_locked = false;
+    std::memset(free_lists, 0, sizeof(free_lists));
+}
+
+int LockedPool::reserve(size_t wanted) {
+    std::lock_guard<std::mutex> lock(mutex);
+    unmap();
+    size_t size = (wanted + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+    if (size == 0) {
+        return 1;
+    }
+
+#ifdef _WIN32
+    // Large pages are never paged out, but need SeLockMemoryPrivilege
+    SIZE_T large = GetLargePageMinimum();
+    if (large > 0) {
+        size_t large_size = (size + large - 1) / large * large;
+        mapping = VirtualAlloc(nullptr, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (mapping) {
+            size = large_size;
+            page_kind = POOL_HUGE_PAGES;
+            is_locked = true;
+        }
+    }
+    if (!mapping) {
+        mapping = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (!mapping) {
+            std::cerr << "Error: Could not allocate a " << size << " byte locked pool." << std::endl;
+            return 1;
+        }
+    }
+    mapping_bytes = size;
+    base = static_cast<char*>(mapping);
+#else
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+#endif
+    if (p != MAP_FAILED) {
+        mapping = p;
+        mapping_bytes = size;
+        base = static_cast<char*>(p);
+        page_kind = POOL_HUGE_PAGES;
+    } else {
+        // No reserved huge pages: map a huge-page-aligned region and ask for transparent huge pages
+        p = mmap(nullptr, size + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            std::cerr << "Error: Could not map a " << size << " byte locked pool: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        mapping = p;
+        mapping_bytes = size + HUGE_PAGE_BYTES;
+        uintptr_t start = reinterpret_cast<uintptr_t>(p);
+        base = reinterpret_cast<char*>((start + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES);
+#ifdef MADV_HUGEPAGE
+        if (madvise(base, size, MADV_HUGEPAGE) == 0) {
+            page_kind = POOL_TRANSPARENT_HUGE_PAGES;
+        }
+#endif
+    }
+#endif
+    bytes = size;
+
+    // Fault every page in now rather than on first use
+    for (size_t i = 0; i < bytes; i += SMALL_PAGE_BYTES) {
+        static_cast<volatile char*>(base)[i] = 0;
+    }
+
+    if (!is_locked) {
+#ifdef _WIN32
+        SIZE_T min_set = 0, max_set = 0;
+        if (GetProcessWorkingSetSize(GetCurrentProcess(), &min_set, &max_set) &&
+            SetProcessWorkingSetSize(GetCurrentProcess(), min_set + bytes, max_set + bytes)) {
+            is_locked = VirtualLock(base, bytes) != 0;
+        }
+        if (!is_locked) {
+            std::cerr << "Warning: Could not lock the " << bytes << " byte pool in RAM." << std::endl;
+        }
+#else
+        is_locked = mlock(base, bytes) == 0;
+        if (!is_locked) {
+            std::cerr << "Warning: Could not lock the " << bytes << " byte pool in RAM (" << std::strerror(errno)
+                      << "); raise the memlock limit (ulimit -l)." << std::endl;
+        }
+#endif
+    }
+    return 0;
+}
+
+void* LockedPool::allocate(size_t wanted, bool& fresh) {
+    size_t total = sizeof(BlockHeader) + wanted;
+    uint32_t size_class = MIN_CLASS;
+    while (size_class < SIZE_CLASSES - 1 && (static_cast<size_t>(1) << size_class) < total) {
+        size_class++;
+    }
+    size_t block_bytes = static_cast<size_t>(1) << size_class;
+
+    BlockHeader* header = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free_lists[size_class]) {
+            header = free_lists[size_class];
+            free_lists[size_class] = header->next_free;
+            fresh = false;
+        } else if (block_bytes <= bytes - offset) {
+            header = reinterpret_cast<BlockHeader*>(base + offset);
+            offset += block_bytes;
+            fresh = true;
+        }
+    }
+
+    if (!header) {
+        // The region is full (or was never mapped); the heap block is freed again on release
+        void* p = ::operator new(total, std::align_val_t(alignof(BlockHeader)), std::nothrow);
+        if (!p) {
+            return nullptr;
+        }
+        heap_blocks.fetch_add(1, std::memory_order_relaxed);
+        header = static_cast<BlockHeader*>(p);
+        header->from_heap = 1;
+        fresh = true;
+    } else {
+        header->from_heap = 0;
+    }
+    header->size_class = size_class;
+    header->next_free = nullptr;
+    return header + 1;
+}
+
+void LockedPool::release(void* block) {
+    if (!block) {
+        return;
+    }
+    BlockHeader* header = static_cast<BlockHeader*>(block) - 1;
+    if (header->from_heap) {
+        ::operator delete(header, std::align_val_t(alignof(BlockHeader)));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    header->next_free = free_lists[header->size_class];
+    free_lists[header->size_class] = header;
+}
+
+size_t LockedPool::used() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return offset;
+}
+
+int pinCurrentThread(int cpu) {
+#ifdef _WIN32
+    if (cpu < 0) {
+        cpu = static_cast<int>(GetCurrentProcessorNumber());
+    }
+    if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8) ||
+        SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) == 0) {
+        return -1;
+    }
+    return cpu;
+#elif defined(__linux__)
+    if (cpu < 0) {
+        cpu = sched_getcpu();
+    }
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return -1;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // With pid 0 this applies to the calling thread only
+    return sched_setaffinity(0, sizeof(set), &set) == 0 ? cpu : -1;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+ScopedThreadPin::ScopedThreadPin(int cpu) : pinned(-1), restore(false) {
+    std::memset(previous, 0, sizeof(previous));
+#ifdef _WIN32
+    if (cpu < 0) {
+        cpu = static_cast<int>(GetCurrentProcessorNumber());
+    }
+    if (cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+        // Returns the previous mask, or 0 on failure
+        DWORD_PTR old_mask = SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu);
+        if (old_mask != 0) {
+            previous[0] = static_cast<uint64_t>(old_mask);
+            pinned = cpu;
+            restore = true;
+        }
+    }
+#elif defined(__linux__)
+    static_assert(sizeof(cpu_set_t) <= sizeof(previous), "cpu_set_t does not fit in ScopedThreadPin");
+    cpu_set_t old_set;
+    if (sched_getaffinity(0, sizeof(old_set), &old_set) == 0) {
+        pinned = pinCurrentThread(cpu);
+        if (pinned >= 0) {
+            std::memcpy(previous, &old_set, sizeof(old_set));
+            restore = true;
+        }
+    }
+#else
+    (void)cpu;
+#endif
+}
+
+ScopedThreadPin::~ScopedThreadPin() {
+    if (!restore) {
+        return;
+    }
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(previous[0]));
+#elif defined(__linux__)
+    cpu_set_t old_set;
+    std::memcpy(&old_set, previous, sizeof(old_set));
+    sched_setaffinity(0, sizeof(old_set), &old_set);
+#endif
+}
+
+uint64_t threadPageFaults() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PageFaultCount;
+    }
+    return 0;
+#else
+    struct rusage usage;
+#ifdef RUSAGE_THREAD
+    if (getrusage(RUSAGE_THREAD, &usage) != 0) {
+        return 0;
+    }
+#else
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#endif
+    return static_cast<uint64_t>(usage.ru_minflt) + static_cast<uint64_t>(usage.ru_majflt);
+#endif
+}
+
+bool lockProcessMemory() {
+#ifdef _WIN32
+    return false;
+#else
+    return mlockall(MCL_CURRENT) == 0;
+#endif
+}
+
+void keepHeapResident() {
+#ifdef __GLIBC__
+    // Never trim the top of the heap, and serve large blocks from it rather than from fresh mappings
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif
+}
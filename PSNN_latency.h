@@ -0,0 +1,140 @@
+// PSNN_latency.h - Locked, pre-faulted memory and thread placement for the low-latency path
+#ifndef PSNN_LATENCY_H
+#define PSNN_LATENCY_H
+
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// How the pages of a LockedPool are backed
+enum PoolPages {
+    POOL_SMALL_PAGES = 0,
+    POOL_TRANSPARENT_HUGE_PAGES = 1,  // Transparent huge pages were requested for the region
+    POOL_HUGE_PAGES = 2               // The region is mapped from the reserved huge-page pool
+};
+
+/**
+ * One region of memory mapped, faulted in and locked up front, handed out in
+ * power-of-two size classes. Freed blocks go back on their class's free list
+ * and are never returned to the system, so once the steady-state working set
+ * has been allocated (by a warm-up), later allocations touch no new pages.
+ * Requests the region cannot satisfy fall back to the heap and are counted.
+ *
+ * Safe to use from several threads at once.
+ */
+class LockedPool {
+public:
+    LockedPool();
+    ~LockedPool();
+
+    LockedPool(const LockedPool&) = delete;
+    LockedPool& operator=(const LockedPool&) = delete;
+
+    /**
+     * Map the region, preferring huge pages, touch every page and lock it in RAM.
+     * Failing to lock is a warning, not an error: the pages stay faulted in.
+     *
+     * @param bytes Region size, rounded up to a whole number of huge pages
+     * @return 0 on success, non-zero if the region could not be mapped
+     */
+    int reserve(size_t bytes);
+
+    /**
+     * @param bytes Bytes wanted
+     * @param fresh Set to true if the block is new memory rather than a reused one
+     * @return 64-byte aligned block, or nullptr if the heap is out of memory too
+     */
+    void* allocate(size_t bytes, bool& fresh);
+
+    /**
+     * @param block Block from allocate(), or nullptr
+     */
+    void release(void* block);
+
+    size_t capacity() const { return bytes; }
+    size_t used() const;
+    PoolPages pages() const { return page_kind; }
+    bool locked() const { return is_locked; }
+    uint64_t overflows() const { return heap_blocks.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t SIZE_CLASSES = 48;
+
+    // Precedes every block; keeps the block 64-byte aligned
+    struct alignas(64) BlockHeader {
+        uint32_t size_class;
+        uint32_t from_heap;
+        BlockHeader* next_free;
+    };
+
+    void unmap();
+
+    mutable std::mutex mutex;  // Guards offset and free_lists
+    char* base;
+    size_t bytes;
+    size_t offset;             // Start of the never-used tail of the region
+    void* mapping;             // What to unmap (base may be aligned within it)
+    size_t mapping_bytes;
+    PoolPages page_kind;
+    bool is_locked;
+    BlockHeader* free_lists[SIZE_CLASSES];
+    std::atomic<uint64_t> heap_blocks;
+};
+
+/**
+ * Pin the calling thread to one CPU.
+ *
+ * @param cpu CPU index, or -1 for the CPU the thread is running on
+ * @return The CPU pinned to, or -1 on failure
+ */
+int pinCurrentThread(int cpu);
+
+/**
+ * Pins the calling thread for as long as the object lives and then gives the
+ * thread back the affinity it had, unless keep() was called. Must be
+ * destroyed on the thread that created it.
+ */
+class ScopedThreadPin {
+public:
+    /**
+     * @param cpu As for pinCurrentThread()
+     */
+    explicit ScopedThreadPin(int cpu);
+    ~ScopedThreadPin();
+
+    ScopedThreadPin(const ScopedThreadPin&) = delete;
+    ScopedThreadPin& operator=(const ScopedThreadPin&) = delete;
+
+    // CPU the thread is pinned to, -1 if pinning failed
+    int cpu() const { return pinned; }
+
+    // Leave the thread pinned when the object is destroyed
+    void keep() { restore = false; }
+
+private:
+    int pinned;
+    bool restore;
+    uint64_t previous[16];     // Saved affinity: a cpu_set_t (Linux) or the mask in previous[0] (Windows)
+};
+
+/**
+ * @return Page faults (minor and major) taken by the calling thread so far, or 0 if unavailable.
+ *         Windows has no per-thread count, so there it is the whole process's.
+ */
+uint64_t threadPageFaults();
+
+/**
+ * Lock every page the process has mapped so far in RAM.
+ *
+ * @return true on success
+ */
+bool lockProcessMemory();
+
+/**
+ * Stop the C heap from returning freed memory to the system, so that blocks
+ * freed between calls are reused without page faults.
+ */
+void keepHeapResident();
+
+#endif // PSNN_LATENCY_H
@@ -0,0 +1,579 @@
+// PSNN_model.cpp - PSNNModel with runtime-selected backends and startup autotuning
+#include <onnxruntime_cxx_api.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "PSNN_model.h"
+#include "PSNN_native.h"
+
+// One way of evaluating the model; run() must be safe to call concurrently
+class ModelBackend {
+public:
+    virtual ~ModelBackend() = default;
+    virtual const std::string& name() const = 0;
+    virtual void run(const float* inputs, size_t rows, float* outputs) = 0;
+};
+
+class OrtModelBackend : public ModelBackend {
+private:
+    std::string backend_name;
+    Ort::Session session;
+    std::vector<std::string> input_node_names;
+    std::vector<std::string> output_node_names;
+    std::vector<const char*> input_names;
+    std::vector<const char*> output_names;
+    size_t input_width;
+    size_t output_width;
+
+public:
+    // threads == 0 leaves the intra-op thread count to ORT
+    OrtModelBackend(Ort::Env& env, const std::vector<char>& model, int threads,
+                    Ort::PrepackedWeightsContainer& prepacked_weights)
+        : backend_name(threads == 0 ? "ort" : "ort-" + std::to_string(threads) + "t"), session(nullptr) {
+        Ort::SessionOptions session_options;
+        if (threads > 0) {
+            session_options.SetIntraOpNumThreads(threads);
+        }
+        session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+        session = Ort::Session(env, model.data(), model.size(), session_options, prepacked_weights);
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        for (size_t i = 0; i < session.GetInputCount(); i++) {
+            input_node_names.push_back(session.GetInputNameAllocated(i, allocator).get());
+        }
+        for (size_t i = 0; i < session.GetOutputCount(); i++) {
+            output_node_names.push_back(session.GetOutputNameAllocated(i, allocator).get());
+        }
+        for (const auto& name : input_node_names) input_names.push_back(name.c_str());
+        for (const auto& name : output_node_names) output_names.push_back(name.c_str());
+
+        std::vector<int64_t> in_shape = session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        std::vector<int64_t> out_shape = session.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        if (in_shape.size() != 2 || out_shape.size() != 2 || in_shape[1] <= 0 || out_shape[1] <= 0) {
+            throw std::runtime_error("model input and output must be [batch, width] tensors");
+        }
+        input_width = static_cast<size_t>(in_shape[1]);
+        output_width = static_cast<size_t>(out_shape[1]);
+    }
+
+    const std::string& name() const override { return backend_name; }
+    size_t inputSize() const { return input_width; }
+    size_t outputSize() const { return output_width; }
+
+    void run(const float* inputs, size_t rows, float* outputs) override {
+        std::vector<int64_t> input_shape = {static_cast<int64_t>(rows), static_cast<int64_t>(input_width)};
+        Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+
+        Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
+            memory_info, const_cast<float*>(inputs), rows * input_width,
+            input_shape.data(), input_shape.size());
+
+        auto output_tensors = session.Run(
+            Ort::RunOptions{nullptr},
+            input_names.data(), &input_tensor, 1,
+            output_names.data(), output_names.size());
+
+        const float* output_data = output_tensors[0].GetTensorMutableData<float>();
+        std::memcpy(outputs, output_data, rows * output_width * sizeof(float));
+    }
+};
+
+class NativeModelBackend : public ModelBackend {
+private:
+    std::string backend_name;
+    NativeModel model;
+
+public:
+    explicit NativeModelBackend(NativeModel&& loaded) : backend_name("native"), model(std::move(loaded)) {}
+
+    const std::string& name() const override { return backend_name; }
+
+    void run(const float* inputs, size_t rows, float* outputs) override {
+        model.run(inputs, rows, outputs);
+    }
+};
+
+// FNV-1a over the model bytes; identifies the model in the tuning cache
+static uint64_t modelHash(const std::vector<char>& bytes) {
+    uint64_t h = 1469598103934665603ULL;
+    for (char c : bytes) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Host identity for the tuning cache: machine name, CPU model and core count
+static std::string hostKey() {
+    std::string host;
+#ifdef _WIN32
+    if (const char* name = std::getenv("COMPUTERNAME")) host = name;
+#else
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) == 0) host = name;
+#endif
+
+    std::string cpu;
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                cpu = line.substr(line.find_first_not_of(' ', colon + 1));
+            }
+            break;
+        }
+    }
+
+    std::string key = (host.empty() ? "unknown" : host) + "|" + cpu + "|" +
+                      std::to_string(std::thread::hardware_concurrency());
+    // Tabs and newlines are the cache file separators
+    std::replace(key.begin(), key.end(), '\t', ' ');
+    std::replace(key.begin(), key.end(), '\n', ' ');
+    return key;
+}
+
+struct TuningEntry {
+    std::string host;
+    std::string model;
+    size_t batch_rows;
+    std::string backend;
+    double ns_per_row;
+};
+
+// Cache lines are "host<TAB>model hash<TAB>batch rows<TAB>backend<TAB>ns per row"
+static std::vector<TuningEntry> readTuningCache(const std::string& path) {
+    std::vector<TuningEntry> entries;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, '\t')) fields.push_back(field);
+        if (fields.size() != 5) continue;
+        try {
+            entries.push_back({fields[0], fields[1], std::stoul(fields[2]), fields[3], std::stod(fields[4])});
+        }
+        catch (const std::exception&) {
+            // Ignore malformed lines; they are dropped on the next write
+        }
+    }
+    return entries;
+}
+
+// Replace this host/model's entries and write the file atomically (temp file + rename)
+static bool writeTuningCache(const std::string& path, const std::string& host, const std::string& model,
+                             const std::vector<TuningEntry>& fresh) {
+    std::vector<TuningEntry> entries = readTuningCache(path);
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const TuningEntry& e) {
+        return e.host == host && e.model == model;
+    }), entries.end());
+    entries.insert(entries.end(), fresh.begin(), fresh.end());
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << "# PSNN tuning cache: host, model hash, batch rows, backend, ns per row\n";
+        for (const TuningEntry& e : entries) {
+            out << e.host << '\t' << e.model << '\t' << e.batch_rows << '\t'
+                << e.backend << '\t' << e.ns_per_row << '\n';
+        }
+        if (!out.good()) return false;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+// Median wall time per row of running batches of batch_rows through a backend
+static double benchmark(ModelBackend& backend, size_t batch_rows, size_t input_width, size_t output_width) {
+    std::vector<float> inputs(batch_rows * input_width);
+    uint32_t state = 12345;
+    for (float& v : inputs) {
+        state = state * 1664525u + 1013904223u;
+        v = static_cast<float>(state >> 8) / 16777216.0f * 4.0f - 2.0f;
+    }
+    std::vector<float> outputs(batch_rows * output_width);
+
+    for (int i = 0; i < 3; i++) {
+        backend.run(inputs.data(), batch_rows, outputs.data());
+    }
+
+    // At least 5 samples, then stop once ~20ms has been spent
+    using clock = std::chrono::steady_clock;
+    std::vector<double> samples;
+    auto start = clock::now();
+    while (samples.size() < 5 ||
+           (samples.size() < 200 && clock::now() - start < std::chrono::milliseconds(20))) {
+        auto t0 = clock::now();
+        backend.run(inputs.data(), batch_rows, outputs.data());
+        auto t1 = clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / batch_rows);
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+class PSNNModel::Impl {
+public:
+    Ort::Env env;
+    Ort::PrepackedWeightsContainer prepacked_weights;  // Shared by the ORT backends, which may coexist
+    std::vector<std::unique_ptr<ModelBackend>> backends;
+    // Sorted by batch size: batches of at least batch_rows rows use backend
+    std::vector<std::pair<size_t, ModelBackend*>> selection;
+    size_t input_width;
+    size_t output_width;
+
+    Impl(const std::string& model_path, const PSNNModelOptions& options)
+        : env(ORT_LOGGING_LEVEL_WARNING, "PSNNModel"), input_width(0), output_width(0) {
+        std::ifstream file(model_path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("could not open model " + model_path);
+        }
+        std::vector<char> model((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        if (options.backend == "auto" && options.autotune) {
+            tune(model, options);
+        }
+        if (selection.empty()) {
+            // Without tuning, "auto" prefers ORT's default configuration and falls back to native
+            ModelBackend* chosen = nullptr;
+            if (options.backend == "auto") {
+                chosen = loadBackend(model, "ort", false);
+                if (chosen == nullptr) chosen = loadBackend(model, "native", false);
+            }
+            else {
+                chosen = loadBackend(model, options.backend, true);
+            }
+            if (chosen == nullptr) {
+                throw std::runtime_error("no backend could load " + model_path);
+            }
+            selection.push_back({0, chosen});
+        }
+
+        // Backends no batch size uses would only hold their weights and thread pools
+        backends.erase(std::remove_if(backends.begin(), backends.end(), [this](const std::unique_ptr<ModelBackend>& b) {
+            return std::none_of(selection.begin(), selection.end(), [&](const std::pair<size_t, ModelBackend*>& s) {
+                return s.second == b.get();
+            });
+        }), backends.end());
+    }
+
+    // Backends "auto" chooses between when tuning, ORT's default configuration first
+    static std::vector<std::string> candidateNames(int threads) {
+        int cores = threads > 0 ? threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::string> names = {"ort", "ort-1t"};
+        if (cores > 1) names.push_back("ort-" + std::to_string(cores) + "t");
+        names.push_back("native");
+        return names;
+    }
+
+    // Intra-op thread count of an ORT backend name: 0 for "ort", N for "ort-<N>t"
+    static int ortThreads(const std::string& name) {
+        if (name == "ort") {
+            return 0;
+        }
+        if (name.size() > 5 && name.compare(0, 4, "ort-") == 0 && name.back() == 't') {
+            int n = std::atoi(name.substr(4, name.size() - 5).c_str());
+            if (n <= 0) {
+                throw std::runtime_error("invalid backend " + name);
+            }
+            return n;
+        }
+        throw std::runtime_error("unknown backend " + name);
+    }
+
+    ModelBackend* findBackend(const std::string& name) const {
+        for (const auto& b : backends) {
+            if (b->name() == name) return b.get();
+        }
+        return nullptr;
+    }
+
+    // The named backend, created on first use. nullptr if it cannot run the model (with the reason on
+    // stderr; for native only when `required`, since "auto" just skips it)
+    ModelBackend* loadBackend(const std::vector<char>& model, const std::string& name, bool required) {
+        if (ModelBackend* existing = findBackend(name)) {
+            return existing;
+        }
+
+        std::unique_ptr<ModelBackend> backend;
+        size_t in_width = 0;
+        size_t out_width = 0;
+        if (name == "native") {
+            OnnxGraph graph;
+            NativeModel native;
+            if (parseOnnxGraph(model.data(), model.size(), graph) != 0 || native.load(graph) != 0) {
+                if (required) {
+                    std::cerr << "Error: the native backend does not support this model." << std::endl;
+                }
+                return nullptr;
+            }
+            in_width = native.inputSize();
+            out_width = native.outputSize();
+            backend = std::make_unique<NativeModelBackend>(std::move(native));
+        }
+        else {
+            int threads = ortThreads(name);
+            try {
+                auto ort = std::make_unique<OrtModelBackend>(env, model, threads, prepacked_weights);
+                in_width = ort->inputSize();
+                out_width = ort->outputSize();
+                backend = std::move(ort);
+            }
+            catch (const Ort::Exception& e) {
+                std::cerr << "ONNX Runtime error: " << e.what() << std::endl;
+                return nullptr;
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return nullptr;
+            }
+        }
+
+        // Every backend of one model must agree on its shape
+        if (!backends.empty() && (in_width != input_width || out_width != output_width)) {
+            std::cerr << "Warning: backend " << name << " reads the model with a different shape; not used." << std::endl;
+            return nullptr;
+        }
+        input_width = in_width;
+        output_width = out_width;
+        backends.push_back(std::move(backend));
+        return backends.back().get();
+    }
+
+    void tune(const std::vector<char>& model, const PSNNModelOptions& options) {
+        std::vector<size_t> sizes = options.tune_batch_sizes;
+        sizes.erase(std::remove(sizes.begin(), sizes.end(), size_t(0)), sizes.end());
+        std::sort(sizes.begin(), sizes.end());
+        sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+        if (sizes.empty()) return;
+
+        std::string host = hostKey();
+        char model_key[17];
+        std::snprintf(model_key, sizeof(model_key), "%016llx",
+                      static_cast<unsigned long long>(modelHash(model)));
+        std::vector<std::string> candidates = candidateNames(options.threads);
+
+        // Use the cached choice if it covers every batch size, loading only the backends it names
+        if (!options.tuning_cache_path.empty()) {
+            std::vector<std::pair<size_t, std::string>> cached;
+            for (const TuningEntry& e : readTuningCache(options.tuning_cache_path)) {
+                if (e.host != host || e.model != model_key) continue;
+                if (std::find(sizes.begin(), sizes.end(), e.batch_rows) == sizes.end()) continue;
+                if (std::find(candidates.begin(), candidates.end(), e.backend) == candidates.end()) continue;
+                cached.push_back({e.batch_rows, e.backend});
+            }
+            std::sort(cached.begin(), cached.end());
+            if (cached.size() == sizes.size()) {
+                std::vector<std::pair<size_t, ModelBackend*>> chosen;
+                for (const auto& c : cached) {
+                    ModelBackend* b = loadBackend(model, c.second, false);
+                    if (b == nullptr) break;
+                    chosen.push_back({c.first, b});
+                }
+                if (chosen.size() == cached.size()) {
+                    selection = chosen;
+                    selection.front().first = 0;
+                    return;
+                }
+            }
+        }
+
+        for (const std::string& name : candidates) {
+            loadBackend(model, name, false);
+        }
+        if (backends.size() < 2) return;
+
+        std::vector<TuningEntry> results;
+        for (size_t batch_rows : sizes) {
+            ModelBackend* best = nullptr;
+            double best_ns = 0.0;
+            for (const auto& b : backends) {
+                double ns;
+                try {
+                    ns = benchmark(*b, batch_rows, input_width, output_width);
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "Warning: benchmarking " << b->name() << " failed: " << e.what() << std::endl;
+                    continue;
+                }
+                if (best == nullptr || ns < best_ns) {
+                    best = b.get();
+                    best_ns = ns;
+                }
+            }
+            if (best == nullptr) {
+                selection.clear();
+                return;
+            }
+            selection.push_back({batch_rows, best});
+            results.push_back({host, model_key, batch_rows, best->name(), best_ns});
+        }
+        // Batches smaller than the smallest tuned size use its choice
+        selection.front().first = 0;
+
+        if (!options.tuning_cache_path.empty() &&
+            !writeTuningCache(options.tuning_cache_path, host, model_key, results)) {
+            std::cerr << "Warning: could not write tuning cache " << options.tuning_cache_path << std::endl;
+        }
+    }
+
+    ModelBackend* backendFor(size_t rows) const {
+        ModelBackend* chosen = selection.front().second;
+        for (const auto& s : selection) {
+            if (rows < s.first) break;
+            chosen = s.second;
+        }
+        return chosen;
+    }
+};
+
+PSNNModel::PSNNModel(const std::string& model_path)
+    : PSNNModel(model_path, PSNNModelOptions()) {}
+
+PSNNModel::PSNNModel(const std::string& model_path, const PSNNModelOptions& options)
+    : pImpl(std::make_unique<Impl>(model_path, options)) {}
+
+PSNNModel::~PSNNModel() = default;
+
+PSNNModel::PSNNModel(PSNNModel&& other) noexcept = default;
+
+PSNNModel& PSNNModel::operator=(PSNNModel&& other) noexcept = default;
+
+int PSNNModel::predict(const std::vector<float>& input_values, std::vector<float>& class_probabilities) {
+    if (!pImpl || input_values.size() % pImpl->input_width != 0) {
+        return 1;
+    }
+    class_probabilities.resize(input_values.size() / pImpl->input_width * pImpl->output_width);
+    return predict(std::span<const float>(input_values), std::span<float>(class_probabilities));
+}
+
+int PSNNModel::predict(std::span<const float> input_values, std::span<float> class_probabilities) {
+    if (!pImpl || input_values.empty() || input_values.size() % pImpl->input_width != 0) {
+        std::cerr << "Error: input size must be a multiple of " << (pImpl ? pImpl->input_width : 0) << std::endl;
+        return 1;
+    }
+    size_t rows = input_values.size() / pImpl->input_width;
+    if (class_probabilities.size() != rows * pImpl->output_width) {
+        std::cerr << "Error: output size must be " << rows * pImpl->output_width << std::endl;
+        return 1;
+    }
+
+    try {
+        pImpl->backendFor(rows)->run(input_values.data(), rows, class_probabilities.data());
+        return 0;
+    }
+    catch (const Ort::Exception& e) {
+        std::cerr << "ONNX Runtime error: " << e.what() << std::endl;
+        return 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+size_t PSNNModel::inputSize() const {
+    return pImpl ? pImpl->input_width : 0;
+}
+
+size_t PSNNModel::outputSize() const {
+    return pImpl ? pImpl->output_width : 0;
+}
+
+std::string PSNNModel::backendName(size_t batch_rows) const {
+    return pImpl ? pImpl->backendFor(batch_rows)->name() : std::string();
+}
+
+size_t PSNNModel::getMaxProbabilityClass(const std::vector<float>& class_probabilities) {
+    return getMaxProbabilityClass(std::span<const float>(class_probabilities));
+}
+
+size_t PSNNModel::getMaxProbabilityClass(std::span<const float> class_probabilities) {
+    if (class_probabilities.empty()) return 0;
+    return static_cast<size_t>(std::max_element(class_probabilities.begin(), class_probabilities.end()) -
+                               class_probabilities.begin());
+}
+
+class PSNNStream::Impl {
+public:
+    NativeModel model;
+    NativeStream stream;
+
+    Impl(const std::string& model_path, const PSNNStreamOptions& options)
+        : model(loadNative(model_path)), stream(model, options.max_changed, options.refresh_interval) {}
+
+    static NativeModel loadNative(const std::string& model_path) {
+        OnnxGraph graph;
+        NativeModel native;
+        if (loadOnnxGraph(model_path, graph) != 0 || native.load(graph) != 0) {
+            throw std::runtime_error("the native kernels could not load " + model_path);
+        }
+        return native;
+    }
+};
+
+PSNNStream::PSNNStream(const std::string& model_path, const PSNNStreamOptions& options)
+    : pImpl(std::make_unique<Impl>(model_path, options)) {}
+
+PSNNStream::~PSNNStream() = default;
+
+PSNNStream::PSNNStream(PSNNStream&& other) noexcept = default;
+
+PSNNStream& PSNNStream::operator=(PSNNStream&& other) noexcept = default;
+
+int PSNNStream::predict(std::span<const float> input_values, std::span<float> class_probabilities) {
+    if (!pImpl || input_values.size() != pImpl->model.inputSize() ||
+        class_probabilities.size() != pImpl->model.outputSize()) {
+        std::cerr << "Error: a stream takes one row of " << inputSize() << " values" << std::endl;
+        return 1;
+    }
+    pImpl->stream.predict(input_values.data(), class_probabilities.data());
+    return 0;
+}
+
+void PSNNStream::reset() {
+    if (pImpl) pImpl->stream.reset();
+}
+
+PSNNStreamStats PSNNStream::stats() const {
+    PSNNStreamStats out;
+    if (!pImpl) return out;
+    const NativeStreamStats& in = pImpl->stream.stats();
+    out.events = in.events;
+    out.full = in.full;
+    out.incremental = in.incremental;
+    out.unchanged = in.unchanged;
+    out.columns_updated = in.columns_updated;
+    return out;
+}
+
+size_t PSNNStream::inputSize() const {
+    return pImpl ? pImpl->model.inputSize() : 0;
+}
+
+size_t PSNNStream::outputSize() const {
+    return pImpl ? pImpl->model.outputSize() : 0;
+}
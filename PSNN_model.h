@@ -3,45 +3,199 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Options for PSNNModel
+ *
+ * Backends are named "ort" (ONNX Runtime CPU provider, default threading),
+ * "ort-1t" / "ort-<N>t" (ONNX Runtime with N intra-op threads) and "native"
+ * (the built-in kernels from PSNN_native.h, when the graph is supported).
+ */
+struct PSNNModelOptions {
+    std::string backend = "auto";                   // A backend name, or "auto" to choose one
+    bool autotune = false;                          // With "auto": benchmark every backend at startup
+    std::vector<size_t> tune_batch_sizes{1, 64, 1024};  // Batch sizes to benchmark
+    std::string tuning_cache_path = "psnn_tuning.cache";  // Empty disables the cache
+    int threads = 0;                                // Threads for the multi-threaded ORT backend, 0 = all cores
+};
 
 /**
  * Inference class for ONNX model predictions
+ *
+ * Move-only; predict() may be called from several threads at once.
  */
 class PSNNModel {
 public:
     /**
      * Constructor
-     * 
+     *
      * @param model_path Path to the ONNX model file
+     * @throws std::runtime_error if the model cannot be loaded by any backend
      */
     PSNNModel(const std::string& model_path);
-    
+
+    /**
+     * Constructor
+     *
+     * With backend "auto" and autotune set, each available backend is timed at
+     * every tune_batch_sizes entry and the fastest is used for batches of that
+     * size and larger. The choice is stored in tuning_cache_path keyed by host
+     * and model, so later runs on the same machine skip the benchmark. Only
+     * the backends in use are kept loaded; without a benchmark, no others are
+     * created.
+     *
+     * @param model_path Path to the ONNX model file
+     * @param options Backend selection and tuning options
+     * @throws std::runtime_error if the model cannot be loaded or the backend is unknown
+     */
+    PSNNModel(const std::string& model_path, const PSNNModelOptions& options);
+
     /**
      * Destructor
      */
     ~PSNNModel();
-    
+
+    PSNNModel(PSNNModel&& other) noexcept;
+    PSNNModel& operator=(PSNNModel&& other) noexcept;
+    PSNNModel(const PSNNModel&) = delete;
+    PSNNModel& operator=(const PSNNModel&) = delete;
+
     /**
      * Run inference on input data
-     * 
+     *
      * @param input_values Vector of input values
      * @param class_probabilities Output vector to store class probabilities
      * @return 0 on success, non-zero on failure
      */
     int predict(const std::vector<float>& input_values, std::vector<float>& class_probabilities);
-    
+
+    /**
+     * Run inference on one or more rows
+     *
+     * @param input_values rows * inputSize() standardised values
+     * @param class_probabilities Receives rows * outputSize() probabilities
+     * @return 0 on success, non-zero on failure (including mismatched sizes)
+     */
+    int predict(std::span<const float> input_values, std::span<float> class_probabilities);
+
+    /**
+     * @return Number of input values per row
+     */
+    size_t inputSize() const;
+
+    /**
+     * @return Number of class probabilities per row
+     */
+    size_t outputSize() const;
+
+    /**
+     * Name of the backend that runs batches of the given size.
+     *
+     * @param batch_rows Batch size
+     * @return Backend name, e.g. "native" or "ort-1t"
+     */
+    std::string backendName(size_t batch_rows = 1) const;
+
     /**
      * Get the index of the highest probability class
-     * 
+     *
      * @param class_probabilities Vector of class probabilities
      * @return Index of the highest probability class
      */
     static size_t getMaxProbabilityClass(const std::vector<float>& class_probabilities);
 
+    /**
+     * Get the index of the highest probability class
+     *
+     * @param class_probabilities Class probabilities of one row
+     * @return Index of the highest probability class
+     */
+    static size_t getMaxProbabilityClass(std::span<const float> class_probabilities);
+
 private:
     // Implementation details
     class Impl;
-    Impl* pImpl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * Options for PSNNStream
+ */
+struct PSNNStreamOptions {
+    size_t max_changed = 16;        // Most changed inputs applied as an update; more triggers a full evaluation
+    size_t refresh_interval = 1024; // Consecutive updates before the first layer is recomputed from scratch
+};
+
+/**
+ * Counters reported by PSNNStream::stats()
+ */
+struct PSNNStreamStats {
+    uint64_t events = 0;
+    uint64_t full = 0;             // Evaluated from scratch
+    uint64_t incremental = 0;      // First layer updated from the previous event
+    uint64_t unchanged = 0;        // Same input as the previous event; result reused
+    uint64_t columns_updated = 0;  // Changed inputs applied by incremental updates
+};
+
+/**
+ * Stateful evaluator for a sequence of related events, e.g. consecutive
+ * windows of one triplet along an alignment. Each event is compared with the
+ * previous one; when only a few inputs changed, the first-layer
+ * pre-activations are updated for those inputs alone and only the remaining
+ * layers are evaluated. Uses the native kernels.
+ *
+ * Move-only and not thread-safe; use one stream per sequence.
+ */
+class PSNNStream {
+public:
+    /**
+     * Constructor
+     *
+     * @param model_path Path to the ONNX model file
+     * @param options Update and refresh limits
+     * @throws std::runtime_error if the model cannot be loaded by the native kernels
+     */
+    PSNNStream(const std::string& model_path, const PSNNStreamOptions& options = PSNNStreamOptions());
+
+    /**
+     * Destructor
+     */
+    ~PSNNStream();
+
+    PSNNStream(PSNNStream&& other) noexcept;
+    PSNNStream& operator=(PSNNStream&& other) noexcept;
+    PSNNStream(const PSNNStream&) = delete;
+    PSNNStream& operator=(const PSNNStream&) = delete;
+
+    /**
+     * Evaluate the next event of the sequence
+     *
+     * @param input_values inputSize() standardised values
+     * @param class_probabilities Receives outputSize() probabilities
+     * @return 0 on success, non-zero on failure (mismatched sizes)
+     */
+    int predict(std::span<const float> input_values, std::span<float> class_probabilities);
+
+    /**
+     * Start a new sequence; the next event is evaluated in full
+     */
+    void reset();
+
+    /**
+     * @return How the events so far were evaluated
+     */
+    PSNNStreamStats stats() const;
+
+    size_t inputSize() const;
+    size_t outputSize() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
 };
 
-#endif // PSNN_MODEL_H
\ No newline at end of file
+#endif // PSNN_MODEL_H
@@ -0,0 +1,577 @@
+// PSNN_native.cpp - Minimal ONNX reader and native CPU kernels for the PSNN network
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "PSNN_native.h"
+
+// ONNX TensorProto.DataType.FLOAT
+static const int64_t ONNX_FLOAT = 1;
+
+// Reader for the protobuf wire format, just enough to walk an ONNX ModelProto
+class ProtoReader {
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+
+public:
+    ProtoReader(const void* data, size_t size)
+        : p(static_cast<const uint8_t*>(data)), end(static_cast<const uint8_t*>(data) + size), ok(true) {}
+
+    ProtoReader(const std::pair<const uint8_t*, size_t>& span) : ProtoReader(span.first, span.second) {}
+
+    bool good() const { return ok; }
+
+    bool atEnd() const { return p >= end; }
+
+    // Read the next field key; false at the end of the message or on error
+    bool next(uint32_t& field, uint32_t& wire) {
+        if (!ok || p >= end) {
+            return false;
+        }
+        uint64_t key = varint();
+        field = static_cast<uint32_t>(key >> 3);
+        wire = static_cast<uint32_t>(key & 7);
+        return ok;
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) break;
+            uint8_t byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (byte < 0x80) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    std::pair<const uint8_t*, size_t> bytes() {
+        uint64_t len = varint();
+        if (!ok || len > static_cast<uint64_t>(end - p)) {
+            ok = false;
+            return {p, 0};
+        }
+        const uint8_t* start = p;
+        p += len;
+        return {start, static_cast<size_t>(len)};
+    }
+
+    std::string string() {
+        auto b = bytes();
+        return std::string(reinterpret_cast<const char*>(b.first), b.second);
+    }
+
+    float fixed32() {
+        float value = 0.0f;
+        if (end - p < 4) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, p, 4);
+        p += 4;
+        return value;
+    }
+
+    void skip(uint32_t wire) {
+        switch (wire) {
+            case 0: varint(); break;
+            case 1: if (end - p < 8) ok = false; else p += 8; break;
+            case 2: bytes(); break;
+            case 5: if (end - p < 4) ok = false; else p += 4; break;
+            default: ok = false; break;
+        }
+    }
+};
+
+static bool parseTensor(ProtoReader r, std::string& name, OnnxTensor& tensor) {
+    int64_t data_type = 0;
+    std::pair<const uint8_t*, size_t> raw{nullptr, 0};
+    uint32_t field, wire;
+
+    while (r.next(field, wire)) {
+        if (field == 1 && wire == 0) {
+            tensor.dims.push_back(static_cast<int64_t>(r.varint()));
+        } else if (field == 1 && wire == 2) {
+            ProtoReader packed(r.bytes());
+            while (packed.good() && !packed.atEnd()) {
+                tensor.dims.push_back(static_cast<int64_t>(packed.varint()));
+            }
+        } else if (field == 2 && wire == 0) {
+            data_type = static_cast<int64_t>(r.varint());
+        } else if (field == 4 && wire == 2) {
+            auto b = r.bytes();
+            for (size_t i = 0; i + 4 <= b.second; i += 4) {
+                float v;
+                std::memcpy(&v, b.first + i, 4);
+                tensor.data.push_back(v);
+            }
+        } else if (field == 4 && wire == 5) {
+            tensor.data.push_back(r.fixed32());
+        } else if (field == 8 && wire == 2) {
+            name = r.string();
+        } else if (field == 9 && wire == 2) {
+            raw = r.bytes();
+        } else {
+            r.skip(wire);
+        }
+    }
+
+    if (!r.good() || data_type != ONNX_FLOAT) {
+        return false;
+    }
+    if (raw.second > 0) {
+        tensor.data.resize(raw.second / sizeof(float));
+        std::memcpy(tensor.data.data(), raw.first, tensor.data.size() * sizeof(float));
+    }
+
+    size_t expected = 1;
+    for (int64_t d : tensor.dims) expected *= static_cast<size_t>(d);
+    return tensor.data.size() == expected;
+}
+
+static bool parseNode(ProtoReader r, OnnxNode& node) {
+    uint32_t field, wire;
+    while (r.next(field, wire)) {
+        if (field == 1 && wire == 2) {
+            node.inputs.push_back(r.string());
+        } else if (field == 2 && wire == 2) {
+            node.outputs.push_back(r.string());
+        } else if (field == 4 && wire == 2) {
+            node.op_type = r.string();
+        } else if (field == 5 && wire == 2) {
+            // AttributeProto: name = 1, f = 2, i = 3
+            ProtoReader a(r.bytes());
+            std::string name;
+            bool has_f = false, has_i = false;
+            float f = 0.0f;
+            int64_t i = 0;
+            uint32_t af, aw;
+            while (a.next(af, aw)) {
+                if (af == 1 && aw == 2) name = a.string();
+                else if (af == 2 && aw == 5) { f = a.fixed32(); has_f = true; }
+                else if (af == 3 && aw == 0) { i = static_cast<int64_t>(a.varint()); has_i = true; }
+                else a.skip(aw);
+            }
+            if (has_f) node.float_attrs[name] = f;
+            if (has_i) node.int_attrs[name] = i;
+        } else {
+            r.skip(wire);
+        }
+    }
+    return r.good();
+}
+
+static bool parseValueInfo(ProtoReader r, OnnxValueInfo& info) {
+    uint32_t field, wire;
+    while (r.next(field, wire)) {
+        if (field == 1 && wire == 2) {
+            info.name = r.string();
+        } else if (field == 2 && wire == 2) {
+            // TypeProto.tensor_type(1).shape(2).dim(1).{dim_value(1) | dim_param(2)}
+            ProtoReader type(r.bytes());
+            uint32_t tf, tw;
+            while (type.next(tf, tw)) {
+                if (tf != 1 || tw != 2) { type.skip(tw); continue; }
+                ProtoReader tensor(type.bytes());
+                uint32_t sf, sw;
+                while (tensor.next(sf, sw)) {
+                    if (sf != 2 || sw != 2) { tensor.skip(sw); continue; }
+                    ProtoReader shape(tensor.bytes());
+                    uint32_t df, dw;
+                    while (shape.next(df, dw)) {
+                        if (df != 1 || dw != 2) { shape.skip(dw); continue; }
+                        ProtoReader dim(shape.bytes());
+                        int64_t value = -1;
+                        uint32_t vf, vw;
+                        while (dim.next(vf, vw)) {
+                            if (vf == 1 && vw == 0) value = static_cast<int64_t>(dim.varint());
+                            else dim.skip(vw);
+                        }
+                        info.dims.push_back(value);
+                    }
+                }
+            }
+        } else {
+            r.skip(wire);
+        }
+    }
+    return r.good();
+}
+
+int parseOnnxGraph(const void* data, size_t size, OnnxGraph& graph) {
+    graph = OnnxGraph();
+    ProtoReader model(data, size);
+    uint32_t field, wire;
+    bool found_graph = false;
+
+    while (model.next(field, wire)) {
+        if (field != 7 || wire != 2) {
+            model.skip(wire);
+            continue;
+        }
+        found_graph = true;
+
+        ProtoReader g(model.bytes());
+        uint32_t gf, gw;
+        while (g.next(gf, gw)) {
+            if (gf == 1 && gw == 2) {
+                OnnxNode node;
+                if (!parseNode(ProtoReader(g.bytes()), node)) return 1;
+                graph.nodes.push_back(std::move(node));
+            } else if (gf == 5 && gw == 2) {
+                std::string name;
+                OnnxTensor tensor;
+                // Non-float initializers are skipped; nodes that need them will fail to compile
+                if (parseTensor(ProtoReader(g.bytes()), name, tensor)) {
+                    graph.initializers[name] = std::move(tensor);
+                }
+            } else if ((gf == 11 || gf == 12) && gw == 2) {
+                OnnxValueInfo info;
+                if (!parseValueInfo(ProtoReader(g.bytes()), info)) return 1;
+                (gf == 11 ? graph.inputs : graph.outputs).push_back(std::move(info));
+            } else {
+                g.skip(gw);
+            }
+        }
+        if (!g.good()) return 1;
+    }
+
+    if (!model.good() || !found_graph) {
+        std::cerr << "Error: Could not parse ONNX model." << std::endl;
+        return 1;
+    }
+
+    // Initializers may also be listed as graph inputs in older exporters
+    graph.inputs.erase(std::remove_if(graph.inputs.begin(), graph.inputs.end(),
+                                      [&](const OnnxValueInfo& v) { return graph.initializers.count(v.name) > 0; }),
+                       graph.inputs.end());
+    return 0;
+}
+
+int loadOnnxGraph(const std::string& path, OnnxGraph& graph) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open model " << path << std::endl;
+        return 1;
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return parseOnnxGraph(bytes.data(), bytes.size(), graph);
+}
+
+// out[rows x m] = in[rows x k] * w[k x m]. Four rows share each weight row load.
+// Zero inputs (common after standardising sparse events) are skipped: an input
+// column that is zero in all four rows of a block, and any zero input in the
+// rows left over.
+static void matmul(const float* __restrict in, const float* __restrict w, float* __restrict out,
+                   size_t rows, size_t k_dim, size_t m) {
+    std::fill(out, out + rows * m, 0.0f);
+
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const float* a = in + r * k_dim;
+        float* __restrict o0 = out + r * m;
+        float* __restrict o1 = o0 + m;
+        float* __restrict o2 = o1 + m;
+        float* __restrict o3 = o2 + m;
+        for (size_t k = 0; k < k_dim; k++) {
+            const float a0 = a[k], a1 = a[k_dim + k], a2 = a[2 * k_dim + k], a3 = a[3 * k_dim + k];
+            if (a0 == 0.0f && a1 == 0.0f && a2 == 0.0f && a3 == 0.0f) continue;
+            const float* __restrict wk = w + k * m;
+            for (size_t j = 0; j < m; j++) {
+                const float wv = wk[j];
+                o0[j] += a0 * wv;
+                o1[j] += a1 * wv;
+                o2[j] += a2 * wv;
+                o3[j] += a3 * wv;
+            }
+        }
+    }
+    for (; r < rows; r++) {
+        const float* a = in + r * k_dim;
+        float* __restrict o = out + r * m;
+        for (size_t k = 0; k < k_dim; k++) {
+            const float av = a[k];
+            if (av == 0.0f) continue;
+            const float* __restrict wk = w + k * m;
+            for (size_t j = 0; j < m; j++) o[j] += av * wk[j];
+        }
+    }
+}
+
+NativeModel::NativeModel() : output_slot(-1), input_width(0), output_width(0), first_layer_width(0) {}
+
+int NativeModel::load(const OnnxGraph& graph) {
+    steps.clear();
+    params.clear();
+    slot_width.clear();
+
+    if (graph.inputs.size() != 1 || graph.outputs.size() != 1 ||
+        graph.inputs[0].dims.size() != 2 || graph.inputs[0].dims[1] <= 0) {
+        std::cerr << "Native: expected one 2-D input and one output." << std::endl;
+        return 1;
+    }
+
+    std::unordered_map<std::string, int> slots;
+    slots[graph.inputs[0].name] = 0;
+    slot_width.push_back(static_cast<size_t>(graph.inputs[0].dims[1]));
+
+    auto param = [&](const std::string& name) -> const OnnxTensor* {
+        auto it = graph.initializers.find(name);
+        return it == graph.initializers.end() ? nullptr : &it->second;
+    };
+    auto slot = [&](const std::string& name) -> int {
+        auto it = slots.find(name);
+        return it == slots.end() ? -1 : it->second;
+    };
+    auto unsupported = [&](const OnnxNode& node) {
+        std::cerr << "Native: unsupported " << node.op_type << " node." << std::endl;
+        return 1;
+    };
+
+    for (const OnnxNode& node : graph.nodes) {
+        if (node.outputs.size() != 1 || node.inputs.empty()) {
+            return unsupported(node);
+        }
+
+        Step step{Op::MatMul, slot(node.inputs[0]), -1, -1, -1, 0, 0, 0.0f, 0.0f};
+        const OnnxTensor* b = node.inputs.size() > 1 ? param(node.inputs[1]) : nullptr;
+
+        // Binary ops may have their activation operand second
+        if (step.in < 0 && node.inputs.size() > 1 && (node.op_type == "Add" || node.op_type == "Mul")) {
+            step.in = slot(node.inputs[1]);
+            b = param(node.inputs[0]);
+        }
+        if (step.in < 0) {
+            return unsupported(node);
+        }
+        step.k = slot_width[step.in];
+        step.m = step.k;
+
+        // Broadcast a [m], [1, m] or scalar initializer to a per-column vector
+        auto vectorParam = [&](const OnnxTensor* t) -> int {
+            if (!t) return -1;
+            std::vector<float> v;
+            if (t->data.size() == 1) v.assign(step.k, t->data[0]);
+            else if (t->data.size() == step.k) v = t->data;
+            else return -1;
+            params.push_back(std::move(v));
+            return static_cast<int>(params.size()) - 1;
+        };
+
+        if (node.op_type == "MatMul") {
+            if (!b || b->dims.size() != 2 || static_cast<size_t>(b->dims[0]) != step.k) {
+                return unsupported(node);
+            }
+            step.op = Op::MatMul;
+            step.m = static_cast<size_t>(b->dims[1]);
+            params.push_back(b->data);
+            step.param = static_cast<int>(params.size()) - 1;
+        } else if (node.op_type == "Add") {
+            int other = slot(node.inputs[1]);
+            if (other >= 0 && other != step.in && slot_width[other] == step.k) {
+                step.op = Op::AddSlot;
+                step.other = other;
+            } else if ((step.param = vectorParam(b)) >= 0) {
+                step.op = Op::AddParam;
+            } else {
+                return unsupported(node);
+            }
+        } else if (node.op_type == "Mul") {
+            if ((step.param = vectorParam(b)) < 0) {
+                return unsupported(node);
+            }
+            step.op = Op::MulParam;
+        } else if (node.op_type == "Clip") {
+            step.op = Op::Clip;
+            step.lo = -HUGE_VALF;
+            step.hi = HUGE_VALF;
+            // Opset >= 11 passes bounds as inputs, older opsets as attributes
+            const OnnxTensor* lo = node.inputs.size() > 1 && !node.inputs[1].empty() ? param(node.inputs[1]) : nullptr;
+            const OnnxTensor* hi = node.inputs.size() > 2 && !node.inputs[2].empty() ? param(node.inputs[2]) : nullptr;
+            if ((node.inputs.size() > 1 && !node.inputs[1].empty() && !lo) ||
+                (node.inputs.size() > 2 && !node.inputs[2].empty() && !hi)) {
+                return unsupported(node);
+            }
+            if (lo && lo->data.size() == 1) step.lo = lo->data[0];
+            if (hi && hi->data.size() == 1) step.hi = hi->data[0];
+            if (node.float_attrs.count("min")) step.lo = node.float_attrs.at("min");
+            if (node.float_attrs.count("max")) step.hi = node.float_attrs.at("max");
+        } else if (node.op_type == "Softmax") {
+            auto axis = node.int_attrs.find("axis");
+            if (axis != node.int_attrs.end() && axis->second != -1 && axis->second != 1) {
+                return unsupported(node);
+            }
+            step.op = Op::Softmax;
+        } else {
+            return unsupported(node);
+        }
+
+        step.out = static_cast<int>(slot_width.size());
+        slot_width.push_back(step.m);
+        slots[node.outputs[0]] = step.out;
+        steps.push_back(step);
+    }
+
+    output_slot = slot(graph.outputs[0].name);
+    if (output_slot <= 0) {
+        std::cerr << "Native: graph output is not produced by a supported node." << std::endl;
+        return 1;
+    }
+
+    input_width = slot_width[0];
+    output_width = slot_width[output_slot];
+    first_layer_width = 0;
+    for (const Step& step : steps) {
+        if (step.op == Op::MatMul && step.in == 0) first_layer_width += step.m;
+    }
+    return 0;
+}
+
+void NativeModel::run(const float* inputs, size_t rows, float* outputs) const {
+    evaluate(inputs, rows, outputs, nullptr);
+}
+
+void NativeModel::evaluate(const float* inputs, size_t rows, float* outputs, const float* first_layer) const {
+    // One scratch area per thread, holding every intermediate activation of the batch
+    thread_local std::vector<float> workspace;
+    std::vector<float*> slot_data(slot_width.size());
+
+    size_t total = 0;
+    for (size_t s = 1; s < slot_width.size(); s++) total += slot_width[s];
+    if (workspace.size() < total * rows) workspace.resize(total * rows);
+
+    slot_data[0] = const_cast<float*>(inputs);
+    float* next = workspace.data();
+    for (size_t s = 1; s < slot_width.size(); s++) {
+        slot_data[s] = next;
+        next += slot_width[s] * rows;
+    }
+
+    for (const Step& step : steps) {
+        const float* in = slot_data[step.in];
+        float* out = slot_data[step.out];
+        const float* p = step.param >= 0 ? params[step.param].data() : nullptr;
+
+        switch (step.op) {
+            case Op::MatMul:
+                if (first_layer && step.in == 0) {
+                    slot_data[step.out] = const_cast<float*>(first_layer);
+                    first_layer += rows * step.m;
+                } else {
+                    matmul(in, p, out, rows, step.k, step.m);
+                }
+                break;
+            case Op::AddParam:
+                for (size_t r = 0; r < rows; r++)
+                    for (size_t j = 0; j < step.m; j++) out[r * step.m + j] = in[r * step.m + j] + p[j];
+                break;
+            case Op::AddSlot: {
+                const float* other = slot_data[step.other];
+                for (size_t i = 0; i < rows * step.m; i++) out[i] = in[i] + other[i];
+                break;
+            }
+            case Op::MulParam:
+                for (size_t r = 0; r < rows; r++)
+                    for (size_t j = 0; j < step.m; j++) out[r * step.m + j] = in[r * step.m + j] * p[j];
+                break;
+            case Op::Clip:
+                for (size_t i = 0; i < rows * step.m; i++) out[i] = std::min(step.hi, std::max(step.lo, in[i]));
+                break;
+            case Op::Softmax:
+                for (size_t r = 0; r < rows; r++) {
+                    const float* a = in + r * step.m;
+                    float* o = out + r * step.m;
+                    float max_v = *std::max_element(a, a + step.m);
+                    float sum = 0.0f;
+                    for (size_t j = 0; j < step.m; j++) {
+                        o[j] = std::exp(a[j] - max_v);
+                        sum += o[j];
+                    }
+                    for (size_t j = 0; j < step.m; j++) o[j] /= sum;
+                }
+                break;
+        }
+    }
+
+    std::memcpy(outputs, slot_data[output_slot], rows * output_width * sizeof(float));
+}
+
+NativeStream::NativeStream(const NativeModel& model, size_t max_changed, size_t refresh_interval)
+    : model(&model), max_changed(max_changed), refresh_interval(std::max<size_t>(1, refresh_interval)),
+      since_refresh(0), primed(false),
+      previous_input(model.inputSize()), previous_output(model.outputSize()),
+      first_layer(model.first_layer_width) {
+    changed.reserve(model.inputSize());
+}
+
+void NativeStream::reset() {
+    primed = false;
+}
+
+void NativeStream::evaluateFull(const float* input, float* outputs) {
+    size_t offset = 0;
+    for (const NativeModel::Step& step : model->steps) {
+        if (step.op == NativeModel::Op::MatMul && step.in == 0) {
+            matmul(input, model->params[step.param].data(), first_layer.data() + offset, 1, step.k, step.m);
+            offset += step.m;
+        }
+    }
+    model->evaluate(input, 1, outputs, first_layer.data());
+    since_refresh = 0;
+    counters.full++;
+}
+
+void NativeStream::predict(const float* input, float* outputs) {
+    const size_t width = model->inputSize();
+    counters.events++;
+
+    changed.clear();
+    bool exact = primed && since_refresh < refresh_interval;
+    if (exact) {
+        for (size_t c = 0; c < width; c++) {
+            if (std::memcmp(&input[c], &previous_input[c], sizeof(float)) == 0) continue;
+            // A non-finite value on either side has no usable difference
+            if (changed.size() == max_changed || !std::isfinite(input[c]) || !std::isfinite(previous_input[c])) {
+                exact = false;
+                break;
+            }
+            changed.push_back(c);
+        }
+    }
+
+    if (!exact) {
+        evaluateFull(input, outputs);
+    } else if (changed.empty()) {
+        std::memcpy(outputs, previous_output.data(), previous_output.size() * sizeof(float));
+        counters.unchanged++;
+        return;
+    } else {
+        size_t offset = 0;
+        for (const NativeModel::Step& step : model->steps) {
+            if (step.op != NativeModel::Op::MatMul || step.in != 0) continue;
+            const float* w = model->params[step.param].data();
+            float* __restrict pre = first_layer.data() + offset;
+            for (size_t c : changed) {
+                const float delta = input[c] - previous_input[c];
+                const float* __restrict wc = w + c * step.m;
+                for (size_t j = 0; j < step.m; j++) pre[j] += delta * wc[j];
+            }
+            offset += step.m;
+        }
+        model->evaluate(input, 1, outputs, first_layer.data());
+        since_refresh++;
+        counters.incremental++;
+        counters.columns_updated += changed.size();
+    }
+
+    std::memcpy(previous_input.data(), input, width * sizeof(float));
+    std::memcpy(previous_output.data(), outputs, previous_output.size() * sizeof(float));
+    primed = true;
+}
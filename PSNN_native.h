@@ -0,0 +1,179 @@
+// PSNN_native.h - Minimal ONNX reader and native CPU kernels for the PSNN network
+#ifndef PSNN_NATIVE_H
+#define PSNN_NATIVE_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// A float initializer from the model
+struct OnnxTensor {
+    std::vector<int64_t> dims;
+    std::vector<float> data;
+};
+
+// One graph node; only the attributes the native kernels need are kept
+struct OnnxNode {
+    std::string op_type;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    std::unordered_map<std::string, int64_t> int_attrs;
+    std::unordered_map<std::string, float> float_attrs;
+};
+
+// A graph input or output; symbolic dimensions are -1
+struct OnnxValueInfo {
+    std::string name;
+    std::vector<int64_t> dims;
+};
+
+// The parts of an ONNX ModelProto the native path understands
+struct OnnxGraph {
+    std::vector<OnnxNode> nodes;
+    std::unordered_map<std::string, OnnxTensor> initializers;
+    std::vector<OnnxValueInfo> inputs;
+    std::vector<OnnxValueInfo> outputs;
+};
+
+/**
+ * Parse an ONNX model held in memory.
+ *
+ * @param data Serialized ModelProto
+ * @param size Size in bytes
+ * @param graph Receives the graph
+ * @return 0 on success, non-zero on failure
+ */
+int parseOnnxGraph(const void* data, size_t size, OnnxGraph& graph);
+
+/**
+ * Read and parse an ONNX model file.
+ *
+ * @param path Path to the .onnx file
+ * @param graph Receives the graph
+ * @return 0 on success, non-zero on failure
+ */
+int loadOnnxGraph(const std::string& path, OnnxGraph& graph);
+
+/**
+ * Native CPU evaluator for feed-forward graphs built from MatMul, Add, Mul,
+ * Clip and Softmax over 2-D float activations, which covers RDP_TripleNN.
+ * run() is const and may be called from several threads at once.
+ */
+class NativeModel {
+public:
+    NativeModel();
+
+    /**
+     * Compile a graph into a sequence of kernel steps.
+     *
+     * @param graph Parsed model
+     * @return 0 on success, non-zero if the graph uses something the native kernels do not support
+     */
+    int load(const OnnxGraph& graph);
+
+    size_t inputSize() const { return input_width; }
+    size_t outputSize() const { return output_width; }
+
+    /**
+     * Evaluate the network.
+     *
+     * @param inputs rows * inputSize() standardised values
+     * @param rows Number of rows
+     * @param outputs Receives rows * outputSize() class probabilities
+     */
+    void run(const float* inputs, size_t rows, float* outputs) const;
+
+private:
+    friend class NativeStream;
+
+    enum class Op { MatMul, AddParam, AddSlot, MulParam, Clip, Softmax };
+
+    struct Step {
+        Op op;
+        int in;            // Activation slot read
+        int other;         // Second activation slot (AddSlot), else -1
+        int out;           // Activation slot written
+        int param;         // Index into params (MatMul/AddParam/MulParam), else -1
+        size_t k;          // Input width
+        size_t m;          // Output width
+        float lo;          // Clip bounds
+        float hi;
+    };
+
+    // Evaluate the steps; if first_layer is given it holds, in step order, the
+    // outputs of every MatMul that reads the model input, which are then not recomputed
+    void evaluate(const float* inputs, size_t rows, float* outputs, const float* first_layer) const;
+
+    std::vector<Step> steps;
+    std::vector<std::vector<float>> params;
+    std::vector<size_t> slot_width;
+    int output_slot;
+    size_t input_width;
+    size_t output_width;
+    size_t first_layer_width;  // Summed widths of the MatMuls that read the model input
+};
+
+// Counters kept by a NativeStream
+struct NativeStreamStats {
+    uint64_t events = 0;
+    uint64_t full = 0;             // Evaluated from scratch
+    uint64_t incremental = 0;      // First layer updated from the previous event
+    uint64_t unchanged = 0;        // Same input as the previous event; result reused
+    uint64_t columns_updated = 0;  // Changed inputs applied by incremental updates
+};
+
+/**
+ * Evaluates a sequence of single events, such as the windows of an alignment
+ * scan, where each event differs from the previous one in only a few inputs.
+ *
+ * The stream keeps the previous input and the first-layer pre-activations.
+ * When at most max_changed inputs differ, each changed input c updates them by
+ * (x_c - x'_c) * W[c, :] instead of redoing the whole first matrix product, and
+ * only the remaining layers are evaluated in full. Larger changes, and every
+ * refresh_interval-th update (to bound rounding drift), fall back to a full
+ * evaluation. Results match run() to float rounding.
+ *
+ * Not thread-safe; use one stream per sequence.
+ */
+class NativeStream {
+public:
+    /**
+     * @param model Loaded model; must outlive the stream
+     * @param max_changed Most changed inputs applied as an update
+     * @param refresh_interval Consecutive updates before the first layer is recomputed
+     */
+    explicit NativeStream(const NativeModel& model, size_t max_changed = 16, size_t refresh_interval = 1024);
+
+    /**
+     * Forget the previous event, so the next one is evaluated in full.
+     */
+    void reset();
+
+    /**
+     * Evaluate the next event of the sequence.
+     *
+     * @param input inputSize() standardised values
+     * @param outputs Receives outputSize() class probabilities
+     */
+    void predict(const float* input, float* outputs);
+
+    const NativeStreamStats& stats() const { return counters; }
+
+private:
+    void evaluateFull(const float* input, float* outputs);
+
+    const NativeModel* model;
+    size_t max_changed;
+    size_t refresh_interval;
+    size_t since_refresh;
+    bool primed;
+    std::vector<float> previous_input;
+    std::vector<float> previous_output;
+    std::vector<float> first_layer;
+    std::vector<size_t> changed;
+    NativeStreamStats counters;
+};
+
+#endif // PSNN_NATIVE_H
@@ -0,0 +1,148 @@
+// PSNN_pool.cpp - Work-stealing thread pool for splitting one large job into tiles
+#include <algorithm>
+
+#include "PSNN_pool.h"
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : job(nullptr), job_workers(0), generation(0), busy(0), stopping(false) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; i++) {
+        ranges.push_back(std::make_unique<TaskRange>());
+    }
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+void WorkStealingPool::parallelFor(size_t n_tasks, size_t max_workers,
+                                   const std::function<void(size_t, size_t)>& fn) {
+    if (n_tasks == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> job_lock(job_mutex);
+
+    size_t n = size();
+    if (max_workers > 0) n = std::min(n, max_workers);
+    n = std::min(n, n_tasks);
+
+    // Contiguous initial runs keep neighbouring tiles on one core until stealing starts
+    for (size_t w = 0; w < n; w++) {
+        ranges[w]->next = n_tasks * w / n;
+        ranges[w]->end = n_tasks * (w + 1) / n;
+    }
+
+    if (n == 1) {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            job_workers = 1;
+        }
+        runTasks(0, fn);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        job = &fn;
+        job_workers = n;
+        busy = n - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks(0, fn);
+
+    std::unique_lock<std::mutex> lock(state_mutex);
+    done.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+void WorkStealingPool::workerLoop(size_t worker) {
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lock(state_mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        if (worker >= job_workers) {
+            continue;
+        }
+
+        const std::function<void(size_t, size_t)>* fn = job;
+        lock.unlock();
+        runTasks(worker, *fn);
+        lock.lock();
+
+        if (--busy == 0) {
+            done.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::runTasks(size_t worker, const std::function<void(size_t, size_t)>& fn) {
+    size_t task;
+    while (takeTask(worker, task)) {
+        fn(task, worker);
+    }
+}
+
+bool WorkStealingPool::takeTask(size_t worker, size_t& task) {
+    TaskRange& own = *ranges[worker];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.next < own.end) {
+            task = own.next++;
+            return true;
+        }
+    }
+
+    // Own run exhausted: steal the back half of the largest remaining run
+    while (true) {
+        size_t victim = job_workers;
+        size_t most = 0;
+        for (size_t w = 0; w < job_workers; w++) {
+            if (w == worker) continue;
+            std::lock_guard<std::mutex> lock(ranges[w]->mutex);
+            size_t remaining = ranges[w]->end - ranges[w]->next;
+            if (remaining > most) {
+                most = remaining;
+                victim = w;
+            }
+        }
+        if (victim == job_workers) {
+            return false;
+        }
+
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(ranges[victim]->mutex);
+            TaskRange& v = *ranges[victim];
+            if (v.next >= v.end) {
+                continue;  // Drained since we looked
+            }
+            begin = v.next + (v.end - v.next) / 2;
+            end = v.end;
+            v.end = begin;
+        }
+
+        task = begin;
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.next = begin + 1;
+        own.end = end;
+        return true;
+    }
+}
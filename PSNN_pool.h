@@ -0,0 +1,74 @@
+// PSNN_pool.h - Work-stealing thread pool for splitting one large job into tiles
+#ifndef PSNN_POOL_H
+#define PSNN_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Fixed set of worker threads that run parallelFor() jobs. Each participating
+ * worker starts with a contiguous run of tasks and, once it runs out, steals
+ * the back half of the largest remaining run, so slow tiles do not leave
+ * cores idle. The calling thread takes part as worker 0.
+ *
+ * One job runs at a time; concurrent parallelFor() calls are serialised.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * @param threads Total workers including the calling thread (at least 1)
+     */
+    explicit WorkStealingPool(size_t threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @return Total number of workers including the calling thread
+     */
+    size_t size() const { return workers.size() + 1; }
+
+    /**
+     * Run fn(task, worker) for every task in [0, n_tasks) and wait for all of them.
+     *
+     * @param n_tasks Number of tasks
+     * @param max_workers Upper bound on workers used, 0 = all
+     * @param fn Task body; worker is in [0, size()) and unique among concurrently running calls;
+     *           fn must not throw
+     */
+    void parallelFor(size_t n_tasks, size_t max_workers, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    // Tasks [next, end) still owned by one worker
+    struct TaskRange {
+        std::mutex mutex;
+        size_t next = 0;
+        size_t end = 0;
+    };
+
+    void workerLoop(size_t worker);
+    void runTasks(size_t worker, const std::function<void(size_t, size_t)>& fn);
+    bool takeTask(size_t worker, size_t& task);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskRange>> ranges;
+
+    std::mutex job_mutex;        // Serialises parallelFor() callers
+    std::mutex state_mutex;      // Guards the fields below
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t, size_t)>* job;
+    size_t job_workers;
+    size_t generation;
+    size_t busy;
+    bool stopping;
+};
+
+#endif // PSNN_POOL_H
@@ -0,0 +1,319 @@
+// PSNN_record.cpp - Recording of prediction requests and their results for replay
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include "PSNN_record.h"
+
+// Buffered bytes that trigger a write
+static const size_t RECORD_BLOCK_BYTES = 1 << 16;
+
+template <typename T>
+static void put(std::vector<char>& buffer, const T& value) {
+    const char* p = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+RecordingWriter::RecordingWriter()
+    : start_ns(0), file(nullptr), failed(false), stopping(false), writing(false), last_layout(0) {}
+
+RecordingWriter::~RecordingWriter() {
+    close();
+}
+
+int RecordingWriter::open(const std::string& path) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex);
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return 1;
+    }
+    failed = false;
+    stopping = false;
+    writing = false;
+    layouts.clear();
+    last_layout = 0;
+    buffer.clear();
+    buffer.reserve(RECORD_BLOCK_BYTES * 2);
+    full.reserve(RECORD_BLOCK_BYTES * 2);
+    start_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+
+    int64_t start_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    buffer.insert(buffer.end(), RECORD_MAGIC, RECORD_MAGIC + sizeof(RECORD_MAGIC));
+    put(buffer, static_cast<uint32_t>(NUM_CLASSES));
+    put(buffer, static_cast<uint32_t>(0));
+    put(buffer, start_unix_ns);
+    writer = std::thread(&RecordingWriter::writerLoop, this);
+    return 0;
+}
+
+int RecordingWriter::close() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!file) {
+        return 0;
+    }
+    stopping = true;
+    wake.notify_all();
+    lock.unlock();
+    writer.join();
+    lock.lock();
+
+    // The writer has finished its last block; what is left is written here
+    if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+        failed = true;
+    }
+    buffer.clear();
+    if (std::fclose(file) != 0) {
+        failed = true;
+    }
+    file = nullptr;
+    return failed ? 1 : 0;
+}
+
+uint64_t RecordingWriter::now() const {
+    int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return static_cast<uint64_t>(std::max<int64_t>(0, now_ns - start_ns.load()));
+}
+
+void RecordingWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return writing || stopping; });
+        if (!writing) {
+            return;
+        }
+        // Nothing else touches `full` while writing is set
+        lock.unlock();
+        bool ok = std::fwrite(full.data(), 1, full.size(), file) == full.size();
+        lock.lock();
+        if (!ok) {
+            failed = true;
+        }
+        full.clear();
+        writing = false;
+    }
+}
+
+// Id of a name list, appending a layout record for one not seen before. Called with mutex held.
+uint32_t RecordingWriter::layoutId(const char* const* names, size_t n) {
+    auto matches = [names, n](const std::vector<std::string>& layout) {
+        if (layout.size() != n) {
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (std::strcmp(layout[i].c_str(), names[i]) != 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    // Callers nearly always send the same names as last time, so that layout is tried first. The
+    // names are compared rather than their pointers, which a caller may reuse for other names
+    if (last_layout < layouts.size() && matches(layouts[last_layout])) {
+        return last_layout;
+    }
+    for (size_t id = 0; id < layouts.size(); id++) {
+        if (matches(layouts[id])) {
+            last_layout = static_cast<uint32_t>(id);
+            return last_layout;
+        }
+    }
+
+    uint32_t id = static_cast<uint32_t>(layouts.size());
+    layouts.emplace_back(names, names + n);
+    put(buffer, RECORD_LAYOUT);
+    put(buffer, id);
+    put(buffer, static_cast<uint32_t>(n));
+    for (size_t i = 0; i < n; i++) {
+        uint16_t length = static_cast<uint16_t>(std::min<size_t>(std::strlen(names[i]), UINT16_MAX));
+        put(buffer, length);
+        buffer.insert(buffer.end(), names[i], names[i] + length);
+    }
+    last_layout = id;
+    return id;
+}
+
+void RecordingWriter::record(uint64_t time_ns, uint64_t latency_ns, const char* const* names, const double* values,
+                             int num_features, const float* probs, int predicted_class) {
+    if (num_features < 0 || (num_features > 0 && (!names || !values))) {
+        return;
+    }
+    size_t n = static_cast<size_t>(num_features);
+    for (size_t i = 0; i < n; i++) {
+        if (!names[i]) return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file) {
+        return;
+    }
+    uint32_t layout = layoutId(names, n);
+    int32_t predicted = predicted_class;
+    float recorded_probs[NUM_CLASSES] = {};
+    if (predicted_class >= 0) {
+        std::memcpy(recorded_probs, probs, sizeof(recorded_probs));
+    }
+
+    // Sized for every value up front and trimmed afterwards, so values are copied without reallocating
+    size_t fixed = 1 + sizeof(time_ns) + sizeof(latency_ns) + sizeof(layout) + sizeof(predicted) + sizeof(recorded_probs);
+    size_t at = buffer.size();
+    buffer.resize(at + fixed + (n + 7) / 8 + n * sizeof(double));
+    char* out = buffer.data() + at;
+    auto write = [&out](const void* p, size_t bytes) {
+        std::memcpy(out, p, bytes);
+        out += bytes;
+    };
+    RecordKind kind = RECORD_REQUEST;
+    write(&kind, 1);
+    write(&time_ns, sizeof(time_ns));
+    write(&latency_ns, sizeof(latency_ns));
+    write(&layout, sizeof(layout));
+    write(&predicted, sizeof(predicted));
+    write(recorded_probs, sizeof(recorded_probs));
+
+    // Every value is copied and the cursor only advances past the non-zero ones, so the loop has no branches
+    char* flags = out;
+    char* dst = out + (n + 7) / 8;
+    for (size_t i = 0; i < n; i += 8) {
+        unsigned flag = 0;
+        for (size_t j = i; j < std::min(n, i + 8); j++) {
+            uint64_t bits;
+            std::memcpy(&bits, values + j, sizeof(bits));
+            std::memcpy(dst, &bits, sizeof(bits));
+            unsigned non_zero = bits != 0;
+            flag |= non_zero << (j - i);
+            dst += non_zero * sizeof(bits);
+        }
+        flags[i / 8] = static_cast<char>(flag);
+    }
+    buffer.resize(static_cast<size_t>(dst - buffer.data()));
+
+    // Hand a full block to the writer; if it is still busy with the last one, keep buffering
+    if (buffer.size() >= RECORD_BLOCK_BYTES && !writing && !stopping) {
+        full.swap(buffer);
+        buffer.clear();
+        writing = true;
+        wake.notify_one();
+    }
+}
+
+// Bounds-checked reads from the loaded file
+struct RecordCursor {
+    const std::vector<char>& data;
+    size_t pos;
+
+    template <typename T>
+    bool get(T& value) {
+        if (data.size() - pos < sizeof(T)) return false;
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool skip(size_t bytes, size_t& at) {
+        if (data.size() - pos < bytes) return false;
+        at = pos;
+        pos += bytes;
+        return true;
+    }
+};
+
+int loadRecording(const std::string& path, Recording& recording) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return 1;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    recording = Recording();
+    RecordCursor cursor{data, 0};
+    char magic[8];
+    uint32_t n_classes = 0, reserved = 0;
+    size_t at = 0;
+    if (!cursor.skip(sizeof(magic), at) || std::memcmp(data.data(), RECORD_MAGIC, sizeof(magic)) != 0 ||
+        !cursor.get(n_classes) || !cursor.get(reserved) || !cursor.get(recording.start_unix_ns)) {
+        std::cerr << "Error: " << path << " is not a PSNN recording." << std::endl;
+        return 1;
+    }
+    if (n_classes != NUM_CLASSES) {
+        std::cerr << "Error: " << path << " has " << n_classes << " classes, expected " << NUM_CLASSES << std::endl;
+        return 1;
+    }
+
+    while (cursor.pos < data.size()) {
+        size_t record_start = cursor.pos;
+        uint8_t kind = 0;
+        bool complete = cursor.get(kind);
+
+        if (complete && kind == RECORD_LAYOUT) {
+            uint32_t id = 0, n = 0;
+            RecordedLayout layout;
+            complete = cursor.get(id) && cursor.get(n) && id == recording.layouts.size();
+            for (uint32_t i = 0; complete && i < n; i++) {
+                uint16_t length = 0;
+                complete = cursor.get(length) && cursor.skip(length, at);
+                if (complete) layout.names.emplace_back(data.data() + at, length);
+            }
+            if (complete) {
+                for (size_t i = 0; i < layout.names.size(); i++) {
+                    if (!isDroppedFeature(layout.names[i])) {
+                        layout.kept.push_back(i);
+                    }
+                }
+                recording.layouts.push_back(std::move(layout));
+            }
+        } else if (complete && kind == RECORD_REQUEST) {
+            RecordedRequest request;
+            complete = cursor.get(request.time_ns) && cursor.get(request.latency_ns) && cursor.get(request.layout) &&
+                       cursor.get(request.predicted_class) && request.layout < recording.layouts.size();
+            for (size_t c = 0; complete && c < NUM_CLASSES; c++) {
+                complete = cursor.get(request.probs[c]);
+            }
+            size_t n = complete ? recording.layouts[request.layout].names.size() : 0;
+            size_t flags_at = 0;
+            complete = complete && cursor.skip((n + 7) / 8, flags_at);
+            if (complete) {
+                request.first_value = recording.values.size();
+                recording.values.resize(request.first_value + n, 0.0);
+                double* values = recording.values.data() + request.first_value;
+                for (size_t i = 0; complete && i < n; i++) {
+                    if (data[flags_at + i / 8] & (1 << (i % 8))) {
+                        complete = cursor.get(values[i]);
+                    }
+                }
+                if (complete) {
+                    recording.requests.push_back(request);
+                } else {
+                    recording.values.resize(request.first_value);
+                }
+            }
+        } else if (complete) {
+            std::cerr << "Error: Unknown record type " << static_cast<int>(kind) << " at byte " << record_start
+                      << " of " << path << std::endl;
+            return 1;
+        }
+
+        if (!complete) {
+            std::cerr << "Warning: " << path << " ends in a partial record at byte " << record_start
+                      << "; it is ignored." << std::endl;
+            break;
+        }
+    }
+    return 0;
+}
+
+int standardiseRecorded(const RecordedLayout& layout, const double* values, float* out) {
+    if (layout.kept.size() != KEPT_FEATURE_COUNT) {
+        return 1;
+    }
+    for (size_t k = 0; k < KEPT_FEATURE_COUNT; k++) {
+        out[k] = static_cast<float>(standardiseValue(k, values[layout.kept[k]]));
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+// PSNN_record.h - Recording of prediction requests and their results for replay
+#ifndef PSNN_RECORD_H
+#define PSNN_RECORD_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+#include "PSNN_features.h"
+
+/**
+ * A recording is a header followed by records, unpadded and in native byte order:
+ *
+ *   header   "PSNNREC1", uint32 n_classes, uint32 reserved, int64 start (Unix time, ns)
+ *   layout   uint8 1, uint32 id, uint32 n_names, n_names * (uint16 length, name bytes)
+ *   request  uint8 2, uint64 time (ns since start), uint64 latency (ns), uint32 layout id,
+ *            int32 predicted class (-1 if the call failed), n_classes * float probabilities,
+ *            (n_names + 7) / 8 bytes of non-zero flags (bit i % 8 of byte i / 8 for value i),
+ *            one double per flagged value
+ *
+ * A layout is the feature name list of a call; it is written once, before the
+ * first request that uses it, so requests carry only their values. Most
+ * features of an RDP event are 0, so only the others are stored; a value is
+ * flagged when any of its bits are set, so -0.0 survives the round trip.
+ */
+static const char RECORD_MAGIC[8] = {'P', 'S', 'N', 'N', 'R', 'E', 'C', '1'};
+
+enum RecordKind : uint8_t {
+    RECORD_LAYOUT = 1,
+    RECORD_REQUEST = 2
+};
+
+/**
+ * Appends requests to a recording. Records are staged in a buffer that a
+ * writer thread takes in blocks, so a process that is killed loses at most
+ * the last block or two.
+ *
+ * Safe to use from several threads at once.
+ */
+class RecordingWriter {
+public:
+    RecordingWriter();
+    ~RecordingWriter();
+
+    RecordingWriter(const RecordingWriter&) = delete;
+    RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+    /**
+     * Create (or truncate) a recording; request times count from now.
+     *
+     * @param path Output file path
+     * @return 0 on success, non-zero on failure
+     */
+    int open(const std::string& path);
+
+    /**
+     * Write out buffered records and close the file.
+     *
+     * @return 0 on success, non-zero if a write failed at any point
+     */
+    int close();
+
+    /**
+     * @return Nanoseconds since open(), to pass to record()
+     */
+    uint64_t now() const;
+
+    /**
+     * Append one request.
+     *
+     * @param time_ns now() when the call arrived
+     * @param latency_ns Time the call took
+     * @param names num_features feature names as passed to the call
+     * @param values num_features values
+     * @param num_features Number of names and values
+     * @param probs NUM_CLASSES probabilities, ignored if predicted_class < 0
+     * @param predicted_class Class returned, or -1 if the call failed
+     */
+    void record(uint64_t time_ns, uint64_t latency_ns, const char* const* names, const double* values, int num_features,
+                const float* probs, int predicted_class);
+
+private:
+    uint32_t layoutId(const char* const* names, size_t n);
+    void writerLoop();
+
+    std::atomic<int64_t> start_ns;  // steady_clock time of open(); read by now() without the lock
+    std::mutex mutex;               // Guards everything below
+    std::condition_variable wake;
+    std::thread writer;             // Writes full blocks, so callers never wait for the disk
+    std::FILE* file;
+    bool failed;
+    bool stopping;
+    bool writing;                   // The writer owns `full`
+    std::vector<std::vector<std::string>> layouts;
+    uint32_t last_layout;           // Layout of the previous request, compared first
+    std::vector<char> buffer;       // Records not yet handed to the writer
+    std::vector<char> full;         // Block being written
+};
+
+// A feature name list as recorded, with the positions PSNN_Predict keeps
+struct RecordedLayout {
+    std::vector<std::string> names;
+    std::vector<size_t> kept;  // Positions of the names that are not dropped, in order
+};
+
+struct RecordedRequest {
+    uint64_t time_ns;
+    uint64_t latency_ns;
+    uint32_t layout;
+    int32_t predicted_class;     // -1 if the recorded call failed
+    float probs[NUM_CLASSES];
+    size_t first_value;          // Offset of the request's values in Recording::values
+};
+
+// A whole recording, read into memory
+struct Recording {
+    int64_t start_unix_ns = 0;
+    std::vector<RecordedLayout> layouts;
+    std::vector<RecordedRequest> requests;
+    std::vector<double> values;
+};
+
+/**
+ * Read a recording. A truncated last record (from a process that was killed)
+ * is dropped with a warning.
+ *
+ * @param path Recording file path
+ * @param recording Receives the layouts and requests
+ * @return 0 on success, non-zero on failure
+ */
+int loadRecording(const std::string& path, Recording& recording);
+
+/**
+ * Drop and standardise a recorded request the way PSNN_Predict does: dropped
+ * features are removed and the rest are standardised by position. Unlike
+ * standardiseRow(), non-finite values are passed on.
+ *
+ * @param layout Layout of the request
+ * @param values The request's values
+ * @param out Receives KEPT_FEATURE_COUNT standardised values
+ * @return 0 on success, non-zero if the request does not have KEPT_FEATURE_COUNT kept values
+ *         (PSNN_Predict fails such calls)
+ */
+int standardiseRecorded(const RecordedLayout& layout, const double* values, float* out);
+
+#endif // PSNN_RECORD_H
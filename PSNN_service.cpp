@@ -0,0 +1,197 @@
+// PSNN_service.cpp - Prioritised, bounded request queues in front of the model
+#include <algorithm>
+#include <cstring>
+
+#include "PSNN_service.h"
+#include "PSNN_trace.h"
+#include "PSNN_drift.h"
+
+PredictionService::PredictionService(const ServiceOptions& options, RunFunction run)
+    : options(options), run(std::move(run)), submitters(0), stopping(false) {
+    std::memset(&counters, 0, sizeof(counters));
+    this->options.tile_rows = std::max<size_t>(1, options.tile_rows);
+    size_t threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(&PredictionService::workerLoop, this);
+    }
+}
+
+PredictionService::~PredictionService() {
+    stop();
+}
+
+int PredictionService::submit(const double* values, size_t n_rows, float* probs, RequestPriority priority,
+                              std::chrono::steady_clock::time_point deadline) {
+    if (priority < 0 || priority >= PRIORITY_COUNT || (n_rows > 0 && (!values || !probs))) {
+        return SERVICE_FAILED;
+    }
+    if (n_rows == 0) {
+        return SERVICE_OK;
+    }
+
+    Request request;
+    request.values = values;
+    request.n_rows = n_rows;
+    request.probs = probs;
+    request.priority = priority;
+    request.deadline = deadline;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (stopping) {
+        return SERVICE_STOPPED;
+    }
+
+    // Expired requests that no worker has reached yet should not hold a place in the queue
+    std::deque<Request*>& queue = queues[priority];
+    if (queue.size() >= options.queue_capacity[priority]) {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<Request*> expired;
+        for (Request* queued : queue) {
+            if (queued->next_row == 0 && queued->deadline < now) expired.push_back(queued);
+        }
+        for (Request* queued : expired) {
+            retire(queued, SERVICE_EXPIRED);
+        }
+    }
+    if (queue.size() >= options.queue_capacity[priority]) {
+        counters.rejected[priority]++;
+        return SERVICE_OVERLOADED;
+    }
+
+    queue.push_back(&request);
+    submitters++;
+    if (n_rows > options.tile_rows) {
+        work.notify_all();
+    } else {
+        work.notify_one();
+    }
+    request.finished.wait(lock, [&request] { return request.done; });
+
+    // stop() waits for this, so the service outlives every submitter that got this far
+    if (--submitters == 0 && stopping) {
+        drained.notify_all();
+    }
+    return request.status;
+}
+
+ServiceStats PredictionService::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    ServiceStats out = counters;
+    for (size_t p = 0; p < PRIORITY_COUNT; p++) {
+        out.queued[p] = queues[p].size();
+    }
+    return out;
+}
+
+void PredictionService::stop() {
+    std::vector<std::thread> joining;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        for (size_t p = 0; p < PRIORITY_COUNT; p++) {
+            std::vector<Request*> pending(queues[p].begin(), queues[p].end());
+            for (Request* request : pending) {
+                retire(request, SERVICE_STOPPED);
+            }
+        }
+        joining.swap(workers);
+        work.notify_all();
+
+        // Woken submitters still have to take the mutex to leave submit(); requests with tiles
+        // running finish when the workers do
+        drained.wait(lock, [this] { return submitters == 0; });
+    }
+    for (auto& t : joining) {
+        t.join();
+    }
+}
+
+// Take a request out of its queue with a final status; it completes once its running tiles finish.
+// Called with mutex held.
+void PredictionService::retire(Request* request, int status) {
+    std::deque<Request*>& queue = queues[request->priority];
+    auto it = std::find(queue.begin(), queue.end(), request);
+    if (it != queue.end()) {
+        queue.erase(it);
+    }
+    if (request->status == SERVICE_OK) {
+        request->status = status;
+    }
+    request->next_row = request->n_rows;
+    finishIfIdle(request);
+}
+
+// Wake the submitter once every row has been handed out and no tile is running. Called with mutex held.
+void PredictionService::finishIfIdle(Request* request) {
+    if (request->done || request->in_flight > 0 || request->next_row < request->n_rows) {
+        return;
+    }
+    size_t p = request->priority;
+    switch (request->status) {
+        case SERVICE_OK: counters.completed[p]++; break;
+        case SERVICE_EXPIRED: counters.expired[p]++; break;
+        case SERVICE_FAILED: counters.failed[p]++; break;
+        default: break;
+    }
+    request->done = true;
+    // Notify under the lock: the submitter owns the request and returns as soon as it sees done
+    request->finished.notify_one();
+}
+
+void PredictionService::workerLoop() {
+    std::vector<float> inputs(options.tile_rows * KEPT_FEATURE_COUNT);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        work.wait(lock, [this] {
+            return stopping || !queues[PRIORITY_INTERACTIVE].empty() || !queues[PRIORITY_BULK].empty();
+        });
+        if (stopping) {
+            return;
+        }
+
+        std::deque<Request*>& queue = !queues[PRIORITY_INTERACTIVE].empty() ? queues[PRIORITY_INTERACTIVE]
+                                                                            : queues[PRIORITY_BULK];
+        Request* request = queue.front();
+        if (request->deadline != NO_DEADLINE && std::chrono::steady_clock::now() > request->deadline) {
+            retire(request, SERVICE_EXPIRED);
+            continue;
+        }
+
+        // Claim the next tile; the request leaves the queue once all its rows are claimed
+        size_t first = request->next_row;
+        size_t n = std::min(options.tile_rows, request->n_rows - first);
+        request->next_row += n;
+        request->in_flight++;
+        if (request->next_row == request->n_rows) {
+            queue.pop_front();
+        }
+        lock.unlock();
+
+        bool ok;
+        {
+            TraceRequest trace;
+            {
+                TraceSpan span("standardise");
+                bool drift = driftMonitorEnabled();
+                uint32_t zeroed[KEPT_FEATURE_COUNT] = {};
+                for (size_t r = 0; r < n; r++) {
+                    standardiseRow(request->values + (first + r) * FEATURE_COUNT, inputs.data() + r * KEPT_FEATURE_COUNT,
+                                   drift ? zeroed : nullptr);
+                }
+                if (drift) {
+                    recordDrift(inputs.data(), n, zeroed);
+                }
+            }
+            ok = run(inputs.data(), n, request->probs + first * NUM_CLASSES);
+        }
+
+        lock.lock();
+        request->in_flight--;
+        if (ok) {
+            finishIfIdle(request);
+        } else {
+            retire(request, SERVICE_FAILED);
+        }
+    }
+}
@@ -0,0 +1,139 @@
+// PSNN_service.h - Prioritised, bounded request queues in front of the model
+#ifndef PSNN_SERVICE_H
+#define PSNN_SERVICE_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+#include "PSNN_features.h"
+
+// Request classes, highest priority first
+enum RequestPriority {
+    PRIORITY_INTERACTIVE = 0,  // A user waiting on the answer, e.g. clicking through events
+    PRIORITY_BULK = 1,         // Overnight scans and other batch work
+    PRIORITY_COUNT = 2
+};
+
+// Outcome of PredictionService::submit()
+enum ServiceStatus {
+    SERVICE_OK = 0,
+    SERVICE_FAILED = 1,      // The model failed to evaluate the request
+    SERVICE_OVERLOADED = 2,  // The request's queue was full; nothing was queued
+    SERVICE_EXPIRED = 3,     // The deadline passed before the request (or all of it) was run
+    SERVICE_STOPPED = 4      // The service stopped before the request was run
+};
+
+// Configuration of a PredictionService
+struct ServiceOptions {
+    size_t queue_capacity[PRIORITY_COUNT] = {64, 16};  // Requests waiting per class before submit() reports overload
+    size_t threads = 1;                                // Worker threads
+    size_t tile_rows = 256;                            // Rows evaluated per step of a larger request
+};
+
+// Counters by request class
+struct ServiceStats {
+    uint64_t completed[PRIORITY_COUNT];
+    uint64_t expired[PRIORITY_COUNT];
+    uint64_t rejected[PRIORITY_COUNT];  // Turned away with SERVICE_OVERLOADED
+    uint64_t failed[PRIORITY_COUNT];
+    size_t queued[PRIORITY_COUNT];      // Waiting or partly run at the time of the call
+};
+
+/**
+ * Runs prediction requests on worker threads from one bounded queue per
+ * priority class. Requests are split into tiles of at most tile_rows rows and
+ * a worker always takes its next tile from the highest-priority non-empty
+ * queue, so an interactive request waits for at most the tiles already
+ * running, not for a whole bulk batch. Requests whose deadline has passed are
+ * dropped instead of run.
+ */
+class PredictionService {
+public:
+    // Evaluates rows of KEPT_FEATURE_COUNT standardised values into NUM_CLASSES
+    // probabilities each; must be safe to call from every worker at once
+    using RunFunction = std::function<bool(const float*, size_t, float*)>;
+
+    static constexpr std::chrono::steady_clock::time_point NO_DEADLINE = std::chrono::steady_clock::time_point::max();
+
+    /**
+     * Start the worker threads.
+     *
+     * @param options Queue sizes, threads and tile size
+     * @param run Model evaluation
+     */
+    PredictionService(const ServiceOptions& options, RunFunction run);
+
+    /**
+     * Stop the service; see stop().
+     */
+    ~PredictionService();
+
+    PredictionService(const PredictionService&) = delete;
+    PredictionService& operator=(const PredictionService&) = delete;
+
+    /**
+     * Queue n_rows events and wait until they have been evaluated, dropped or rejected.
+     *
+     * @param values n_rows * FEATURE_COUNT raw values in FEATURE_NAMES order
+     * @param n_rows Number of events
+     * @param probs Receives n_rows * NUM_CLASSES probabilities
+     * @param priority Request class
+     * @param deadline Time by which the request must have started, or NO_DEADLINE. Tiles of a
+     *                 partly run request are not started after it either.
+     * @return A ServiceStatus; with SERVICE_EXPIRED or SERVICE_FAILED, earlier tiles may have been written
+     */
+    int submit(const double* values, size_t n_rows, float* probs, RequestPriority priority,
+               std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @return Counters since the service started
+     */
+    ServiceStats stats() const;
+
+    /**
+     * Finish the tiles that are running, complete every queued request with
+     * SERVICE_STOPPED, wait for every submitter to return from submit() and
+     * join the workers. Later submits return SERVICE_STOPPED. Once stop() has
+     * returned, no thread is using the service's state and it may be destroyed.
+     */
+    void stop();
+
+private:
+    struct Request {
+        const double* values;
+        size_t n_rows;
+        float* probs;
+        RequestPriority priority;
+        std::chrono::steady_clock::time_point deadline;
+        size_t next_row = 0;   // First row not yet handed to a worker
+        size_t in_flight = 0;  // Tiles being evaluated
+        int status = SERVICE_OK;
+        bool done = false;
+        std::condition_variable finished;
+    };
+
+    void workerLoop();
+    void retire(Request* request, int status);
+    void finishIfIdle(Request* request);
+
+    ServiceOptions options;
+    RunFunction run;
+    std::vector<std::thread> workers;
+
+    mutable std::mutex mutex;  // Guards everything below
+    std::condition_variable work;
+    std::condition_variable drained;  // Signalled when the last submitter leaves after stopping
+    std::deque<Request*> queues[PRIORITY_COUNT];
+    ServiceStats counters;
+    size_t submitters;                // Threads waiting in submit()
+    bool stopping;
+};
+
+#endif // PSNN_SERVICE_H
@@ -0,0 +1,411 @@
+// PSNN_shm.cpp - Shared-memory request ring between RDP processes and a resident PSNN server
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <chrono>
+
+#include "PSNN_shm.h"
+#include "PSNN_drift.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Spin iterations before sleeping on a futex; a batch of the model takes a few microseconds.
+// On a single CPU spinning only delays the other side, so sleep at once.
+static int spinLimit() {
+    static const int limit = std::thread::hardware_concurrency() > 1 ? 4000 : 0;
+    return limit;
+}
+
+static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+static uint32_t* futexWord(std::atomic<uint32_t>& word) {
+    return reinterpret_cast<uint32_t*>(&word);
+}
+
+// The mapping is shared between processes, so the non-private futex operations are used
+static void futexWait(std::atomic<uint32_t>& word, uint32_t current, long timeout_ms) {
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, futexWord(word), FUTEX_WAIT, current, &timeout, nullptr, 0);
+}
+
+static void futexWakeAll(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, futexWord(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Publish a new sequence value and wake sleepers, skipping the syscall when there are none
+static void publish(ShmSlot* slot, uint32_t value) {
+    slot->sequence.store(value, std::memory_order_seq_cst);
+    if (slot->waiters.load(std::memory_order_seq_cst) != 0) {
+        futexWakeAll(slot->sequence);
+    }
+}
+
+// Wait until slot->sequence == target. alive() is polled every 100 ms while asleep;
+// returns false if it reports the other side has gone.
+template <typename Alive>
+static bool waitFor(ShmSlot* slot, uint32_t target, Alive alive) {
+    for (int i = 0; i < spinLimit(); i++) {
+        if (slot->sequence.load(std::memory_order_acquire) == target) return true;
+        cpuRelax();
+    }
+    while (true) {
+        slot->waiters.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t current = slot->sequence.load(std::memory_order_seq_cst);
+        if (current != target) {
+            futexWait(slot->sequence, current, 100);
+        }
+        slot->waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+        if (slot->sequence.load(std::memory_order_acquire) == target) return true;
+        if (!alive()) return false;
+    }
+}
+
+static bool processAlive(int32_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+static uint64_t claimWord(uint32_t ticket, int32_t pid) {
+    return (static_cast<uint64_t>(ticket) << 32) | static_cast<uint32_t>(pid);
+}
+
+static size_t ringBytes(uint32_t capacity) {
+    return sizeof(ShmRingHeader) + static_cast<size_t>(capacity) * sizeof(ShmSlot);
+}
+#endif
+
+ShmRing::ShmRing() : header(nullptr), mapped_bytes(0), owner(false) {}
+
+ShmRing::~ShmRing() {
+    close();
+}
+
+ShmSlot* ShmRing::slot(uint64_t ticket) const {
+    ShmSlot* slots = reinterpret_cast<ShmSlot*>(header + 1);
+    return slots + (ticket & (header->capacity - 1));
+}
+
+#ifdef __linux__
+int ShmRing::create(const std::string& ring_name, uint32_t slots) {
+    close();
+    uint32_t capacity = SHM_MIN_SLOTS;
+    while (capacity < slots && capacity < (1u << 20)) capacity <<= 1;
+
+    // A ring left by a server that has exited is replaced; one whose server is still running is not
+    int existing = shm_open(ring_name.c_str(), O_RDONLY, 0);
+    if (existing >= 0) {
+        struct stat st;
+        int32_t live_pid = 0;
+        if (fstat(existing, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmRingHeader)) {
+            void* p = mmap(nullptr, sizeof(ShmRingHeader), PROT_READ, MAP_SHARED, existing, 0);
+            if (p != MAP_FAILED) {
+                const ShmRingHeader* h = static_cast<const ShmRingHeader*>(p);
+                // Any version of the ring, so a running older server is not taken over either
+                if (std::memcmp(h->magic, SHM_MAGIC, sizeof(SHM_MAGIC) - 1) == 0 &&
+                    h->server_state.load(std::memory_order_acquire) != SHM_SERVER_STOPPED &&
+                    processAlive(h->server_pid)) {
+                    live_pid = h->server_pid;
+                }
+                munmap(p, sizeof(ShmRingHeader));
+            }
+        }
+        ::close(existing);
+        if (live_pid != 0) {
+            std::cerr << "Error: " << ring_name << " is in use by a running server (pid " << live_pid << ")."
+                      << std::endl;
+            return 1;
+        }
+    }
+    shm_unlink(ring_name.c_str());
+    int fd = shm_open(ring_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cerr << "Error: shm_open " << ring_name << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    size_t bytes = ringBytes(capacity);
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        std::cerr << "Error: ftruncate " << ring_name << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(ring_name.c_str());
+        return 1;
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "Error: mmap " << ring_name << ": " << std::strerror(errno) << std::endl;
+        shm_unlink(ring_name.c_str());
+        return 1;
+    }
+
+    header = new (p) ShmRingHeader();
+    header->n_features = static_cast<uint32_t>(FEATURE_COUNT);
+    header->n_classes = static_cast<uint32_t>(NUM_CLASSES);
+    header->capacity = capacity;
+    header->server_pid = static_cast<int32_t>(getpid());
+    header->server_state.store(SHM_SERVER_STARTING);
+    header->tail.store(0);
+    header->head.store(0);
+    for (uint32_t i = 0; i < capacity; i++) {
+        ShmSlot* s = new (reinterpret_cast<ShmSlot*>(header + 1) + i) ShmSlot();
+        s->sequence.store(i);
+        s->waiters.store(0);
+        s->claim.store(claimWord(i - capacity, 0));
+    }
+    // Clients check the magic last, after the layout is in place
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+
+    name = ring_name;
+    mapped_bytes = bytes;
+    owner = true;
+    return 0;
+}
+
+int ShmRing::open(const std::string& ring_name) {
+    close();
+    int fd = shm_open(ring_name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "Error: No PSNN server at " << ring_name << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+        std::cerr << "Error: " << ring_name << " is not a PSNN ring." << std::endl;
+        ::close(fd);
+        return 1;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "Error: mmap " << ring_name << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    ShmRingHeader* h = static_cast<ShmRingHeader*>(p);
+    if (std::memcmp(h->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) != 0 || h->n_features != FEATURE_COUNT ||
+        h->n_classes != NUM_CLASSES || h->capacity == 0 || (h->capacity & (h->capacity - 1)) != 0 ||
+        ringBytes(h->capacity) != bytes) {
+        std::cerr << "Error: " << ring_name << " has an incompatible layout." << std::endl;
+        munmap(p, bytes);
+        return 1;
+    }
+
+    header = h;
+    name = ring_name;
+    mapped_bytes = bytes;
+    owner = false;
+    return 0;
+}
+
+void ShmRing::close() {
+    if (!header) {
+        return;
+    }
+    if (owner) {
+        header->server_state.store(SHM_SERVER_STOPPED);
+        shm_unlink(name.c_str());
+    }
+    munmap(header, mapped_bytes);
+    header = nullptr;
+    mapped_bytes = 0;
+    owner = false;
+}
+
+int ShmRing::predict(const double* values, float* class_probabilities, int32_t* predicted_class) {
+    if (!header || !values || !class_probabilities || !predicted_class) {
+        return 1;
+    }
+    auto server_alive = [this] {
+        if (header->server_state.load(std::memory_order_acquire) == SHM_SERVER_STOPPED) return false;
+        return processAlive(header->server_pid);
+    };
+    if (header->server_state.load(std::memory_order_acquire) != SHM_SERVER_READY) {
+        return 1;
+    }
+
+    uint64_t ticket = header->tail.fetch_add(1, std::memory_order_relaxed);
+    ShmSlot* s = slot(ticket);
+    uint32_t t = static_cast<uint32_t>(ticket);
+
+    // Wait for the previous lap's client to release the slot, unless the server has skipped the ticket
+    auto not_skipped = [s, t, &server_alive] {
+        return (s->claim.load(std::memory_order_acquire) >> 32) != t && server_alive();
+    };
+    if (!waitFor(s, t, not_skipped)) {
+        return 1;
+    }
+    uint64_t claim = s->claim.load(std::memory_order_acquire);
+    if ((claim >> 32) == t || !s->claim.compare_exchange_strong(claim, claimWord(t, getpid()))) {
+        return 1;
+    }
+    std::memcpy(s->values, values, sizeof(s->values));
+    publish(s, t + 1);
+
+    if (!waitFor(s, t + 2, server_alive)) {
+        return 1;
+    }
+    int status = s->status;
+    std::memcpy(class_probabilities, s->class_probabilities, sizeof(s->class_probabilities));
+    *predicted_class = s->predicted_class;
+    publish(s, t + header->capacity);
+    return status;
+}
+
+int ShmRing::serve(size_t max_batch, const std::function<bool(const float*, size_t, float*)>& run,
+                   const std::atomic<bool>& stop) {
+    if (!header || !owner) {
+        return 1;
+    }
+    max_batch = std::max<size_t>(1, std::min<size_t>(max_batch, header->capacity));
+    std::vector<float> inputs(max_batch * KEPT_FEATURE_COUNT);
+    std::vector<float> probs(max_batch * NUM_CLASSES);
+    uint32_t zeroed[KEPT_FEATURE_COUNT];
+    // While idle, control comes back after every 100 ms sleep to check stop and look for dead clients
+    auto keep_sleeping = [] { return false; };
+    uint64_t waiting_head = header->head.load(std::memory_order_relaxed);
+    uint32_t waiting_sequence = slot(waiting_head)->sequence.load(std::memory_order_relaxed);
+    auto waiting_since = std::chrono::steady_clock::now();
+
+    header->server_state.store(SHM_SERVER_READY, std::memory_order_release);
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t head = header->head.load(std::memory_order_relaxed);
+        if (!waitFor(slot(head), static_cast<uint32_t>(head + 1), keep_sleeping)) {
+            // Time how long ticket head's slot has stayed as it is
+            auto now = std::chrono::steady_clock::now();
+            uint32_t sequence = slot(head)->sequence.load(std::memory_order_acquire);
+            if (head != waiting_head || sequence != waiting_sequence) {
+                waiting_head = head;
+                waiting_sequence = sequence;
+                waiting_since = now;
+            }
+            long waited_ms = static_cast<long>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(now - waiting_since).count());
+            if (reclaim(head, waited_ms)) {
+                header->head.store(head + 1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+
+        // Take every request that is already waiting, in ticket order
+        size_t n = 1;
+        while (n < max_batch &&
+               slot(head + n)->sequence.load(std::memory_order_acquire) == static_cast<uint32_t>(head + n + 1)) {
+            n++;
+        }
+        bool drift = driftMonitorEnabled();
+        std::fill(zeroed, zeroed + KEPT_FEATURE_COUNT, 0u);
+        for (size_t i = 0; i < n; i++) {
+            standardiseRow(slot(head + i)->values, inputs.data() + i * KEPT_FEATURE_COUNT, drift ? zeroed : nullptr);
+        }
+        if (drift) {
+            recordDrift(inputs.data(), n, zeroed);
+        }
+        bool ok = run(inputs.data(), n, probs.data());
+
+        for (size_t i = 0; i < n; i++) {
+            ShmSlot* s = slot(head + i);
+            const float* p = probs.data() + i * NUM_CLASSES;
+            s->status = ok ? 0 : 1;
+            s->predicted_class = 0;
+            for (size_t c = 0; c < NUM_CLASSES; c++) {
+                s->class_probabilities[c] = ok ? p[c] : 0.0f;
+                if (ok && p[c] > p[s->predicted_class]) s->predicted_class = static_cast<int32_t>(c);
+            }
+            publish(s, static_cast<uint32_t>(head + i + 2));
+        }
+        header->head.store(head + n, std::memory_order_relaxed);
+    }
+
+    header->server_state.store(SHM_SERVER_STOPPED, std::memory_order_release);
+    return 0;
+}
+
+// Free ticket head's slot if the client holding it has exited; called by the server while it
+// waits for the request. Returns true if ticket head was skipped.
+bool ShmRing::reclaim(uint64_t head, long waited_ms) {
+    if (header->tail.load(std::memory_order_acquire) <= head) {
+        return false;
+    }
+    ShmSlot* s = slot(head);
+    uint32_t t = static_cast<uint32_t>(head);
+    uint32_t previous = t - header->capacity;
+    uint32_t sequence = s->sequence.load(std::memory_order_acquire);
+    uint64_t claim = s->claim.load(std::memory_order_acquire);
+    int32_t pid = static_cast<int32_t>(claim & 0xFFFFFFFFull);
+
+    // The previous lap's client exited before reading its response
+    if (sequence == previous + 2) {
+        if ((claim >> 32) == previous && !processAlive(pid)) {
+            std::cerr << "Warning: Client " << pid << " exited without releasing its slot; slot freed." << std::endl;
+            publish(s, t);
+        }
+        return false;
+    }
+    if (sequence != t) {
+        return false;
+    }
+
+    // The client claimed the slot and exited before publishing its request
+    if ((claim >> 32) == t) {
+        if (processAlive(pid)) {
+            return false;
+        }
+        std::cerr << "Warning: Client " << pid << " exited during a request; ticket " << head << " skipped."
+                  << std::endl;
+        publish(s, t + header->capacity);
+        return true;
+    }
+
+    // The ticket was taken but its client never claimed the free slot
+    if (waited_ms >= SHM_ABANDON_MS && s->claim.compare_exchange_strong(claim, claimWord(t, 0))) {
+        std::cerr << "Warning: Ticket " << head << " was not claimed within " << SHM_ABANDON_MS << " ms; skipped."
+                  << std::endl;
+        publish(s, t + header->capacity);
+        return true;
+    }
+    return false;
+}
+#else
+int ShmRing::create(const std::string&, uint32_t) {
+    std::cerr << "Error: The shared-memory transport is only available on Linux." << std::endl;
+    return 1;
+}
+
+int ShmRing::open(const std::string&) {
+    std::cerr << "Error: The shared-memory transport is only available on Linux." << std::endl;
+    return 1;
+}
+
+void ShmRing::close() {}
+
+int ShmRing::predict(const double*, float*, int32_t*) {
+    return 1;
+}
+
+int ShmRing::serve(size_t, const std::function<bool(const float*, size_t, float*)>&, const std::atomic<bool>&) {
+    return 1;
+}
+#endif
@@ -0,0 +1,143 @@
+// PSNN_shm.h - Shared-memory request ring between RDP processes and a resident PSNN server
+#ifndef PSNN_SHM_H
+#define PSNN_SHM_H
+
+#include <string>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "PSNN_features.h"
+
+/**
+ * Layout of the shared mapping: a ShmRingHeader followed by `capacity` ShmSlots.
+ *
+ * Each slot has a 32-bit sequence word that is also its futex. A client takes
+ * ticket t from `tail` (so any number of clients may submit) and uses slot
+ * t % capacity:
+ *
+ *   sequence == t              slot free for ticket t; client writes values
+ *   sequence == t + 1          request ready; the server picks it up in ticket order
+ *   sequence == t + 2          response ready; client reads the result
+ *   sequence == t + capacity   client done; slot free for the next lap
+ *
+ * Waiters spin briefly and then sleep on the sequence word; the other side
+ * only issues a wake when the slot's waiter count is non-zero.
+ *
+ * Before writing its request the client claims the free slot by setting its
+ * claim word to (t << 32) | pid, so the server can tell whose slot it is
+ * waiting on. While it waits for ticket head, the server frees the slot of a
+ * client that has exited:
+ *
+ *   - response of the previous lap never collected: the slot is released (t)
+ *   - claimed but no request published: ticket t is skipped (t + capacity)
+ *   - never claimed for SHM_ABANDON_MS: ticket t is skipped; the claim word is
+ *     set to (t << 32) first, so a client that is merely slow finds its ticket
+ *     gone and fails the call instead of writing into the next lap
+ */
+static const char SHM_MAGIC[8] = {'P', 'S', 'N', 'N', 'S', 'H', 'M', '2'};
+
+// The four sequence values above must differ, so a ring has at least this many slots
+static const uint32_t SHM_MIN_SLOTS = 4;
+
+// Time a taken ticket may go unclaimed on a free slot before the server skips it
+static const long SHM_ABANDON_MS = 1000;
+
+enum ShmServerState : uint32_t {
+    SHM_SERVER_STARTING = 0,
+    SHM_SERVER_READY = 1,
+    SHM_SERVER_STOPPED = 2
+};
+
+struct ShmRingHeader {
+    char magic[8];
+    uint32_t n_features;           // FEATURE_COUNT raw values per request
+    uint32_t n_classes;            // NUM_CLASSES probabilities per response
+    uint32_t capacity;             // Slots, a power of two
+    int32_t server_pid;
+    alignas(64) std::atomic<uint32_t> server_state;
+    alignas(64) std::atomic<uint64_t> tail;   // Next ticket handed to a client
+    alignas(64) std::atomic<uint64_t> head;   // Next ticket the server will answer
+};
+
+struct ShmSlot {
+    alignas(64) std::atomic<uint32_t> sequence;  // Protocol state and futex word (see above)
+    std::atomic<uint32_t> waiters;               // Threads sleeping on sequence
+    std::atomic<uint64_t> claim;                 // (ticket << 32) | pid of the client holding the slot
+    int32_t predicted_class;
+    int32_t status;                              // 0 = ok, non-zero = server failed this request
+    float class_probabilities[NUM_CLASSES];
+    double values[FEATURE_COUNT];                // Raw features in FEATURE_NAMES order
+};
+
+/**
+ * A mapped ring, as created by the server or opened by a client
+ */
+class ShmRing {
+public:
+    ShmRing();
+    ~ShmRing();
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    /**
+     * Create a ring; used by the server. A ring left under the same name by a
+     * server that has exited is replaced; a running server's is not.
+     *
+     * @param name Shared memory object name, e.g. "/psnn"
+     * @param slots Requested slot count, rounded up to a power of two and at least SHM_MIN_SLOTS
+     * @return 0 on success, non-zero on failure
+     */
+    int create(const std::string& name, uint32_t slots);
+
+    /**
+     * Map an existing ring; used by clients.
+     *
+     * @param name Shared memory object name given to the server
+     * @return 0 on success, non-zero on failure (no server, or incompatible layout)
+     */
+    int open(const std::string& name);
+
+    /**
+     * Unmap the ring; the server also removes the name.
+     */
+    void close();
+
+    /**
+     * Submit one event and wait for its result. Safe to call from many threads
+     * and processes at once.
+     *
+     * @param values FEATURE_COUNT raw feature values
+     * @param class_probabilities Receives NUM_CLASSES probabilities
+     * @param predicted_class Receives the predicted class
+     * @return 0 on success, non-zero if the server failed the request, skipped it or went away
+     */
+    int predict(const double* values, float* class_probabilities, int32_t* predicted_class);
+
+    /**
+     * Answer requests until stop is set; used by the server. Contiguous ready
+     * requests are standardised and evaluated together, up to max_batch at a time.
+     * The standardised batches go to recordDrift() while the drift monitor is on.
+     * Slots held by clients that have exited are freed (see above).
+     *
+     * @param max_batch Largest batch handed to run
+     * @param run Evaluates rows of KEPT_FEATURE_COUNT standardised values into NUM_CLASSES probabilities each
+     * @param stop Checked at least every 100 ms while idle
+     * @return 0 on a clean stop, non-zero on failure
+     */
+    int serve(size_t max_batch, const std::function<bool(const float*, size_t, float*)>& run,
+              const std::atomic<bool>& stop);
+
+private:
+    ShmSlot* slot(uint64_t ticket) const;
+    bool reclaim(uint64_t head, long waited_ms);
+
+    std::string name;
+    ShmRingHeader* header;
+    size_t mapped_bytes;
+    bool owner;
+};
+
+#endif // PSNN_SHM_H
@@ -0,0 +1,272 @@
+// PSNN_store.cpp - Memory-mapped result store with a hash index on event ID
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "PSNN_store.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static_assert(sizeof(ResultStoreHeader) == 64, "ResultStoreHeader must stay 64 bytes");
+
+// Record index + 1 in the low half of a slot; the high half holds the hash tag
+static const uint64_t SLOT_RECORD_MASK = 0xFFFFFFFFull;
+
+static bool sameEventId(const EventId& a, const EventId& b) {
+    return a.alignment == b.alignment && a.sequences[0] == b.sequences[0] && a.sequences[1] == b.sequences[1] &&
+           a.sequences[2] == b.sequences[2] && a.window == b.window;
+}
+
+uint64_t resultStoreHash(const EventId& id) {
+    // Each word is folded in with a multiply-xorshift step, then the MurmurHash3 finaliser spreads
+    // every input bit over both halves (the low bits pick the slot, the high bits are the tag)
+    const uint32_t words[5] = {id.alignment, id.sequences[0], id.sequences[1], id.sequences[2], id.window};
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    for (uint32_t w : words) {
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+int writeResultStore(const std::string& path, const std::vector<StoredResult>& records) {
+    if (records.size() >= SLOT_RECORD_MASK) {
+        std::cerr << "Error: A result store holds at most " << SLOT_RECORD_MASK - 1 << " events." << std::endl;
+        return 1;
+    }
+
+    // At most half full, so a lookup for a missing ID meets an empty slot within a few probes
+    uint64_t n_slots = 16;
+    while (n_slots < records.size() * 2) {
+        n_slots *= 2;
+    }
+    uint64_t mask = n_slots - 1;
+    std::vector<uint64_t> slots(n_slots, 0);
+    size_t duplicates = 0;
+    for (size_t r = 0; r < records.size(); r++) {
+        uint64_t h = resultStoreHash(records[r].id);
+        uint64_t tag = h >> 32;
+        for (uint64_t i = h & mask;; i = (i + 1) & mask) {
+            if (slots[i] == 0) {
+                slots[i] = (tag << 32) | (r + 1);
+                break;
+            }
+            if ((slots[i] >> 32) == tag && sameEventId(records[(slots[i] & SLOT_RECORD_MASK) - 1].id, records[r].id)) {
+                duplicates++;
+                break;
+            }
+        }
+    }
+    if (duplicates > 0) {
+        std::cerr << "Warning: " << duplicates << " duplicate event ID(s) in " << path
+                  << "; lookups return the first result for each." << std::endl;
+    }
+
+    ResultStoreHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RESULT_STORE_MAGIC, sizeof(RESULT_STORE_MAGIC));
+    header.record_bytes = sizeof(StoredResult);
+    header.n_classes = NUM_CLASSES;
+    header.n_records = records.size();
+    header.n_slots = n_slots;
+    header.slots_offset = sizeof(header);
+    header.records_offset = header.slots_offset + n_slots * sizeof(uint64_t);
+
+    std::string tmp_path = path + ".tmp";
+    std::FILE* file = std::fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open " << tmp_path << " for writing." << std::endl;
+        return 1;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(slots.data(), sizeof(uint64_t), slots.size(), file) == slots.size() &&
+              std::fwrite(records.data(), sizeof(StoredResult), records.size(), file) == records.size() &&
+              std::fflush(file) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = std::fclose(file) == 0 && ok;
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Could not write result store " << path << std::endl;
+        std::remove(tmp_path.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+ResultStore::ResultStore()
+    : mapping(nullptr), mapping_bytes(0),
+#ifdef _WIN32
+      file_mapping(nullptr),
+#endif
+      slots(nullptr), records(nullptr), slot_mask(0), n_records(0) {}
+
+ResultStore::~ResultStore() {
+    close();
+}
+
+void ResultStore::close() {
+    if (mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping);
+        CloseHandle(file_mapping);
+        file_mapping = nullptr;
+#else
+        munmap(mapping, mapping_bytes);
+#endif
+    }
+    mapping = nullptr;
+    mapping_bytes = 0;
+    slots = nullptr;
+    records = nullptr;
+    slot_mask = 0;
+    n_records = 0;
+}
+
+int ResultStore::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return 1;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart >= static_cast<LONGLONG>(sizeof(ResultStoreHeader))) {
+        file_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (file_mapping) {
+            mapping = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!mapping) {
+                CloseHandle(file_mapping);
+                file_mapping = nullptr;
+            }
+        }
+        mapping_bytes = static_cast<size_t>(size.QuadPart);
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open " << path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ResultStoreHeader)) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            mapping = p;
+            mapping_bytes = st.st_size;
+            // Lookups land anywhere in the file; read-ahead would only fill the page cache
+            madvise(p, mapping_bytes, MADV_RANDOM);
+        }
+    }
+    ::close(fd);
+#endif
+    if (!mapping) {
+        mapping_bytes = 0;
+        std::cerr << "Error: Could not map " << path << " (empty or unreadable)." << std::endl;
+        return 1;
+    }
+
+    const ResultStoreHeader* header = static_cast<const ResultStoreHeader*>(mapping);
+    uint64_t bytes = mapping_bytes;
+    bool valid = std::memcmp(header->magic, RESULT_STORE_MAGIC, sizeof(RESULT_STORE_MAGIC)) == 0 &&
+                 header->record_bytes == sizeof(StoredResult) && header->n_classes == NUM_CLASSES &&
+                 header->n_slots > header->n_records && (header->n_slots & (header->n_slots - 1)) == 0 &&
+                 header->slots_offset % alignof(uint64_t) == 0 && header->records_offset % alignof(StoredResult) == 0 &&
+                 header->slots_offset <= bytes && header->n_slots <= (bytes - header->slots_offset) / sizeof(uint64_t) &&
+                 header->records_offset <= bytes &&
+                 header->n_records <= (bytes - header->records_offset) / sizeof(StoredResult);
+    if (!valid) {
+        std::cerr << "Error: " << path << " is not a PSNN result store." << std::endl;
+        close();
+        return 1;
+    }
+    const char* base = static_cast<const char*>(mapping);
+    slots = reinterpret_cast<const uint64_t*>(base + header->slots_offset);
+    records = reinterpret_cast<const StoredResult*>(base + header->records_offset);
+    slot_mask = header->n_slots - 1;
+    n_records = static_cast<size_t>(header->n_records);
+    return 0;
+}
+
+const StoredResult* ResultStore::find(const EventId& id) const {
+    if (!slots) {
+        return nullptr;
+    }
+    uint64_t h = resultStoreHash(id);
+    uint64_t tag = h >> 32;
+    // The probe count bound only matters for a damaged file with no empty slot
+    for (uint64_t i = h & slot_mask, probes = 0; probes <= slot_mask; i = (i + 1) & slot_mask, probes++) {
+        uint64_t slot = slots[i];
+        if (slot == 0) {
+            return nullptr;
+        }
+        uint64_t r = (slot & SLOT_RECORD_MASK) - 1;
+        if ((slot >> 32) == tag && r < n_records && sameEventId(records[r].id, id)) {
+            return records + r;
+        }
+    }
+    return nullptr;
+}
+
+int loadEventIds(const std::string& path, std::vector<EventId>& ids) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return 1;
+    }
+    ids.clear();
+    std::string line;
+    for (size_t line_no = 1; std::getline(in, line); line_no++) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        uint32_t fields[5];
+        const char* p = line.c_str() + first;
+        bool ok = true;
+        for (int f = 0; ok && f < 5; f++) {
+            while (*p == ' ' || *p == '\t') p++;
+            char* end = nullptr;
+            errno = 0;
+            unsigned long long value = std::strtoull(p, &end, 10);
+            ok = *p >= '0' && *p <= '9' && errno == 0 && value <= UINT32_MAX;
+            fields[f] = static_cast<uint32_t>(value);
+            while (ok && (*end == ' ' || *end == '\t')) end++;
+            if (ok && f < 4) {
+                ok = *end == ',';
+                end++;
+            } else if (ok) {
+                ok = *end == '\0' || *end == '\r';
+            }
+            p = end;
+        }
+        if (!ok) {
+            std::cerr << "Error: " << path << ":" << line_no << ": expected alignment,seq1,seq2,seq3,window" << std::endl;
+            return 1;
+        }
+        ids.push_back(EventId{fields[0], {fields[1], fields[2], fields[3]}, fields[4]});
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+// PSNN_store.h - Memory-mapped result store with a hash index on event ID
+#ifndef PSNN_STORE_H
+#define PSNN_STORE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "PSNN_features.h"
+
+// Identity of an RDP event: the alignment, the sequence triplet and the scan window
+struct EventId {
+    uint32_t alignment;
+    uint32_t sequences[3];
+    uint32_t window;
+};
+
+// One event's result as held in a store
+struct StoredResult {
+    EventId id;
+    float class_probabilities[NUM_CLASSES];
+    int32_t predicted_class;
+};
+
+/**
+ * A store is one file, unpadded except where noted and in native byte order:
+ *
+ *   header   ResultStoreHeader (64 bytes)
+ *   slots    n_slots * uint64 at slots_offset (64-byte aligned): 0 for an empty slot, else
+ *            (upper 32 bits of the ID's hash << 32) | (record index + 1)
+ *   records  n_records * StoredResult at records_offset, in input order
+ *
+ * The slots are an open-addressing table probed linearly from (hash & (n_slots - 1)).
+ * n_slots is a power of two at least twice n_records, so probes are short and
+ * always reach an empty slot. The hash is resultStoreHash(), which does not
+ * change between builds or platforms.
+ */
+static const char RESULT_STORE_MAGIC[8] = {'P', 'S', 'N', 'N', 'R', 'E', 'S', '1'};
+
+struct ResultStoreHeader {
+    char magic[8];
+    uint32_t record_bytes;    // sizeof(StoredResult)
+    uint32_t n_classes;
+    uint64_t n_records;
+    uint64_t n_slots;
+    uint64_t slots_offset;
+    uint64_t records_offset;
+    uint64_t reserved[2];
+};
+
+/**
+ * @param id Event ID
+ * @return Hash of the ID used by the slot table
+ */
+uint64_t resultStoreHash(const EventId& id);
+
+/**
+ * Write a store holding the given records, replacing any file at path
+ * atomically (temp file + rename), so readers that have the old file mapped
+ * keep a consistent view. If an ID occurs more than once, lookups find the
+ * first record with it; the duplicates are counted in a warning.
+ *
+ * @param path Output file path
+ * @param records Records in input order
+ * @return 0 on success, non-zero on failure
+ */
+int writeResultStore(const std::string& path, const std::vector<StoredResult>& records);
+
+/**
+ * Read-only view of a store. The file is mapped shared, so any number of
+ * processes reading the same store share one copy in the page cache, and
+ * lookups return pointers into the mapping rather than copies.
+ *
+ * find() is const and may be called from several threads at once.
+ */
+class ResultStore {
+public:
+    ResultStore();
+    ~ResultStore();
+
+    ResultStore(const ResultStore&) = delete;
+    ResultStore& operator=(const ResultStore&) = delete;
+
+    /**
+     * Map a store and check its header.
+     *
+     * @param path Store file path
+     * @return 0 on success, non-zero on failure
+     */
+    int open(const std::string& path);
+
+    void close();
+
+    /**
+     * @param id Event ID
+     * @return The event's record in the mapping, or nullptr if the store does not hold it
+     */
+    const StoredResult* find(const EventId& id) const;
+
+    size_t size() const { return n_records; }
+
+    /**
+     * @param index Record index, below size()
+     * @return The record at that position in input order
+     */
+    const StoredResult& record(size_t index) const { return records[index]; }
+
+private:
+    void* mapping;
+    size_t mapping_bytes;
+#ifdef _WIN32
+    void* file_mapping;  // HANDLE of the file mapping object
+#endif
+    const uint64_t* slots;
+    const StoredResult* records;
+    uint64_t slot_mask;
+    size_t n_records;
+};
+
+/**
+ * Read event IDs, one "alignment,seq1,seq2,seq3,window" line per event in
+ * input order. Blank lines and lines starting with '#' are skipped.
+ *
+ * @param path IDs file path
+ * @param ids Receives the IDs
+ * @return 0 on success, non-zero on failure
+ */
+int loadEventIds(const std::string& path, std::vector<EventId>& ids);
+
+#endif // PSNN_STORE_H
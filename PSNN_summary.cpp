@@ -0,0 +1,123 @@
+// PSNN_summary.cpp - Mergeable aggregate statistics for bulk runs
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "PSNN_summary.h"
+
+// Confidence quantiles reported per class
+static const double REPORT_QUANTILES[] = {0.05, 0.25, 0.5, 0.75, 0.95};
+
+void initSummary(RunSummary& summary, const std::vector<double>& thresholds) {
+    std::memset(&summary, 0, sizeof(summary));
+    summary.n_thresholds = static_cast<uint32_t>(std::min(thresholds.size(), SUMMARY_MAX_THRESHOLDS));
+    for (size_t i = 0; i < summary.n_thresholds; i++) {
+        summary.thresholds[i] = thresholds[i];
+    }
+}
+
+void addToSummary(RunSummary& summary, const float* probs) {
+    size_t predicted = 0;
+    for (size_t c = 1; c < NUM_CLASSES; c++) {
+        if (probs[c] > probs[predicted]) predicted = c;
+    }
+
+    summary.events++;
+    summary.class_counts[predicted]++;
+
+    float confidence = std::min(1.0f, std::max(0.0f, probs[predicted]));
+    size_t bin = std::min(SUMMARY_BINS - 1, static_cast<size_t>(confidence * SUMMARY_BINS));
+    summary.confidence_hist[predicted][bin]++;
+
+    for (size_t c = 0; c < NUM_CLASSES; c++) {
+        for (size_t t = 0; t < summary.n_thresholds; t++) {
+            if (probs[c] >= summary.thresholds[t]) summary.above_threshold[c][t]++;
+        }
+    }
+}
+
+void mergeSummary(RunSummary& into, const RunSummary& from) {
+    into.events += from.events;
+    for (size_t c = 0; c < NUM_CLASSES; c++) {
+        into.class_counts[c] += from.class_counts[c];
+        for (size_t b = 0; b < SUMMARY_BINS; b++) {
+            into.confidence_hist[c][b] += from.confidence_hist[c][b];
+        }
+        for (size_t t = 0; t < into.n_thresholds; t++) {
+            into.above_threshold[c][t] += from.above_threshold[c][t];
+        }
+    }
+}
+
+double summaryQuantile(const RunSummary& summary, size_t predicted_class, double q) {
+    if (predicted_class >= NUM_CLASSES) return 0.0;
+    uint64_t total = summary.class_counts[predicted_class];
+    if (total == 0) return 0.0;
+
+    // Rank of the quantile, then linear interpolation inside the bin that holds it
+    double rank = std::min(1.0, std::max(0.0, q)) * total;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < SUMMARY_BINS; b++) {
+        uint64_t count = summary.confidence_hist[predicted_class][b];
+        if (count > 0 && seen + count >= rank) {
+            double within = (rank - seen) / count;
+            return (b + within) / SUMMARY_BINS;
+        }
+        seen += count;
+    }
+    return 1.0;
+}
+
+int writeSummary(const std::string& path, const RunSummary& summary) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return 1;
+    }
+
+    char line[256];
+    out << "events," << summary.events << "\n";
+    out << "class,count,fraction,p05,p25,p50,p75,p95\n";
+    for (size_t c = 0; c < NUM_CLASSES; c++) {
+        double fraction = summary.events ? static_cast<double>(summary.class_counts[c]) / summary.events : 0.0;
+        int len = std::snprintf(line, sizeof(line), "%zu,%llu,%.6g", c,
+                                static_cast<unsigned long long>(summary.class_counts[c]), fraction);
+        out.write(line, len);
+        for (double q : REPORT_QUANTILES) {
+            len = std::snprintf(line, sizeof(line), ",%.4f", summaryQuantile(summary, c, q));
+            out.write(line, len);
+        }
+        out << "\n";
+    }
+
+    if (summary.n_thresholds > 0) {
+        out << "threshold";
+        for (size_t c = 0; c < NUM_CLASSES; c++) out << ",class " << c;
+        out << "\n";
+        for (size_t t = 0; t < summary.n_thresholds; t++) {
+            out << summary.thresholds[t];
+            for (size_t c = 0; c < NUM_CLASSES; c++) out << "," << summary.above_threshold[c][t];
+            out << "\n";
+        }
+    }
+    return out.good() ? 0 : 1;
+}
+
+bool parseThresholds(const std::string& text, std::vector<double>& thresholds) {
+    thresholds.clear();
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        char* end = nullptr;
+        double value = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || value < 0.0 || value > 1.0) {
+            return false;
+        }
+        thresholds.push_back(value);
+    }
+    return !thresholds.empty() && thresholds.size() <= SUMMARY_MAX_THRESHOLDS;
+}
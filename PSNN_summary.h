@@ -0,0 +1,83 @@
+// PSNN_summary.h - Mergeable aggregate statistics for bulk runs
+#ifndef PSNN_SUMMARY_H
+#define PSNN_SUMMARY_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "PSNN_features.h"
+
+// Histogram bins over [0, 1]; quantiles are exact to 1 / SUMMARY_BINS
+static const size_t SUMMARY_BINS = 1000;
+static const size_t SUMMARY_MAX_THRESHOLDS = 16;
+
+/**
+ * Aggregates over a set of scored events. Plain data with no pointers, so one
+ * summary per thread or worker process can live in a shared mapping; partial
+ * summaries with the same thresholds combine exactly with mergeSummary().
+ */
+struct RunSummary {
+    uint64_t events;
+    uint64_t class_counts[NUM_CLASSES];                       // Events by predicted class
+    uint64_t confidence_hist[NUM_CLASSES][SUMMARY_BINS];      // Winning probability, by predicted class
+    uint32_t n_thresholds;
+    double thresholds[SUMMARY_MAX_THRESHOLDS];
+    uint64_t above_threshold[NUM_CLASSES][SUMMARY_MAX_THRESHOLDS];  // Events with P(class) >= threshold
+};
+
+/**
+ * Reset a summary.
+ *
+ * @param summary Summary to reset
+ * @param thresholds Probability thresholds to count events above (at most SUMMARY_MAX_THRESHOLDS used)
+ */
+void initSummary(RunSummary& summary, const std::vector<double>& thresholds);
+
+/**
+ * Add one scored event.
+ *
+ * @param summary Summary to update
+ * @param probs NUM_CLASSES class probabilities
+ */
+void addToSummary(RunSummary& summary, const float* probs);
+
+/**
+ * Add another summary's counts into this one. Both must use the same thresholds.
+ *
+ * @param into Summary to update
+ * @param from Summary to add
+ */
+void mergeSummary(RunSummary& into, const RunSummary& from);
+
+/**
+ * Confidence quantile of the events predicted as one class.
+ *
+ * @param summary Summary
+ * @param predicted_class Class index
+ * @param q Quantile in [0, 1]
+ * @return Interpolated confidence, or 0 if no event was predicted as the class
+ */
+double summaryQuantile(const RunSummary& summary, size_t predicted_class, double q);
+
+/**
+ * Write a compact CSV report: class counts with confidence quantiles, then
+ * the above-threshold counts for each class.
+ *
+ * @param path Output file path
+ * @param summary Summary to report
+ * @return 0 on success, non-zero on failure
+ */
+int writeSummary(const std::string& path, const RunSummary& summary);
+
+/**
+ * Parse a comma-separated list of thresholds in [0, 1].
+ *
+ * @param text e.g. "0.5,0.9,0.99"
+ * @param thresholds Receives the values
+ * @return true if the list is valid, false otherwise
+ */
+bool parseThresholds(const std::string& text, std::vector<double>& thresholds);
+
+#endif // PSNN_SUMMARY_H
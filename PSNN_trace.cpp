@@ -0,0 +1,286 @@
+// PSNN_trace.cpp - Opt-in per-request stage tracing exported as a Chrome trace
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "PSNN_trace.h"
+
+// One recorded stage
+struct TraceRecord {
+    const char* name;
+    uint64_t request;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+// Single-writer ring of spans owned by one thread. Only the owner writes;
+// the exporter reads behind the published head.
+struct TraceRing {
+    std::vector<TraceRecord> records;
+    size_t mask;
+    std::atomic<uint64_t> head{0};
+    unsigned int thread_index;
+
+    TraceRing(size_t capacity, unsigned int index) : thread_index(index) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        records.resize(size);
+        mask = size - 1;
+    }
+};
+
+// Rings are kept until exit so spans of finished threads can still be exported
+struct TraceState {
+    std::atomic<bool> enabled{false};
+    TraceOptions options;
+    uint64_t sample_threshold = 0;  // Requests whose hash is below this are traced
+    uint64_t origin_ns = 0;         // Timeline zero
+    std::atomic<uint64_t> next_request{1};
+    std::mutex rings_mutex;
+    std::vector<std::unique_ptr<TraceRing>> rings;
+};
+
+static TraceState& traceState() {
+    static TraceState state;
+    return state;
+}
+
+static thread_local TraceRing* t_ring = nullptr;
+static thread_local uint64_t t_request = 0;
+
+// ORT's profiler stamps its start time with high_resolution_clock; use the same clock
+static uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now().time_since_epoch()).count());
+}
+
+static TraceRing* threadRing() {
+    if (!t_ring) {
+        TraceState& state = traceState();
+        std::lock_guard<std::mutex> lock(state.rings_mutex);
+        state.rings.push_back(std::make_unique<TraceRing>(state.options.ring_spans,
+                                                          static_cast<unsigned int>(state.rings.size())));
+        t_ring = state.rings.back().get();
+    }
+    return t_ring;
+}
+
+void enableTracing(const TraceOptions& options) {
+    TraceState& state = traceState();
+    state.options = options;
+    state.options.ring_spans = std::max<size_t>(16, options.ring_spans);
+    double rate = std::min(1.0, std::max(0.0, options.sample_rate));
+    state.sample_threshold = rate >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(rate * 18446744073709551615.0);
+    state.origin_ns = nowNs();
+    state.enabled.store(true, std::memory_order_release);
+}
+
+bool tracingEnabled() {
+    return traceState().enabled.load(std::memory_order_acquire);
+}
+
+const TraceOptions& traceOptions() {
+    return traceState().options;
+}
+
+void clearTraceRecords() {
+    TraceState& state = traceState();
+    std::lock_guard<std::mutex> lock(state.rings_mutex);
+    for (const auto& ring : state.rings) {
+        ring->head.store(0, std::memory_order_release);
+    }
+}
+
+TraceRequest::TraceRequest(bool always) : request(0), previous(t_request) {
+    TraceState& state = traceState();
+    if (!state.enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    uint64_t id = state.next_request.fetch_add(1, std::memory_order_relaxed);
+
+    // splitmix64 of the id: an even, stateless spread for the sampling decision
+    uint64_t z = id + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    if (always || state.sample_threshold == UINT64_MAX || z < state.sample_threshold) {
+        request = id;
+        t_request = id;
+    }
+}
+
+TraceRequest::~TraceRequest() {
+    t_request = previous;
+}
+
+TraceSpan::TraceSpan(const char* name) : name(name), start_ns(0) {
+    if (t_request != 0) {
+        start_ns = nowNs();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (start_ns == 0 || t_request == 0) {
+        return;
+    }
+    TraceRing* ring = threadRing();
+    uint64_t h = ring->head.load(std::memory_order_relaxed);
+    ring->records[h & ring->mask] = {name, t_request, start_ns, nowNs()};
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+static void appendEvent(std::vector<std::string>& events, const TraceRecord& r, int pid, unsigned int tid,
+                        uint64_t origin_ns) {
+    char buf[256];
+    double ts = (static_cast<double>(r.start_ns) - static_cast<double>(origin_ns)) / 1000.0;
+    double dur = static_cast<double>(r.end_ns - r.start_ns) / 1000.0;
+    int len = std::snprintf(buf, sizeof(buf),
+                            "{\"name\":\"%s\",\"cat\":\"psnn\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,"
+                            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"request\":%llu}}",
+                            r.name, pid, tid, ts, dur, static_cast<unsigned long long>(r.request));
+    events.emplace_back(buf, std::min<size_t>(len, sizeof(buf) - 1));
+}
+
+// Shift the "ts" field of one ORT profiler event onto the common timeline
+static bool rebaseOrtEvent(std::string& event, double offset_us) {
+    size_t key = event.find("\"ts\"");
+    if (key == std::string::npos) {
+        return false;
+    }
+    size_t pos = event.find(':', key);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = event.find_first_not_of(' ', pos + 1);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    char* end = nullptr;
+    double ts = std::strtod(event.c_str() + pos, &end);
+    size_t len = static_cast<size_t>(end - (event.c_str() + pos));
+    if (len == 0) {
+        return false;
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.3f", ts + offset_us);
+    event.replace(pos, len, buf);
+    return true;
+}
+
+// ORT writes a JSON array with one event object per line
+static int readOrtProfile(const OrtProfile& profile, uint64_t origin_ns, std::vector<std::string>& events) {
+    std::ifstream in(profile.path);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open ORT profile " << profile.path << std::endl;
+        return 1;
+    }
+    double offset_us = (static_cast<double>(profile.start_ns) - static_cast<double>(origin_ns)) / 1000.0;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t first = line.find('{');
+        size_t last = line.rfind('}');
+        if (first == std::string::npos || last == std::string::npos || last < first) {
+            continue;
+        }
+        std::string event = line.substr(first, last - first + 1);
+        if (rebaseOrtEvent(event, offset_us)) {
+            events.push_back(std::move(event));
+        }
+    }
+    return 0;
+}
+
+int collectTraceEvents(const std::vector<OrtProfile>& ort_profiles, std::vector<std::string>& events) {
+    TraceState& state = traceState();
+    int pid = static_cast<int>(getpid());
+
+    std::lock_guard<std::mutex> lock(state.rings_mutex);
+    for (const auto& ring : state.rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t capacity = ring->records.size();
+        uint64_t first = head > capacity ? head - capacity : 0;
+
+        std::vector<TraceRecord> copy;
+        copy.reserve(head - first);
+        for (uint64_t i = first; i < head; i++) {
+            copy.push_back(ring->records[i & ring->mask]);
+        }
+        // Drop records the owner may have overwritten while we copied
+        uint64_t after = ring->head.load(std::memory_order_acquire);
+        uint64_t valid_from = after > capacity ? after - capacity : 0;
+        size_t skip = valid_from > first ? static_cast<size_t>(std::min<uint64_t>(valid_from - first, copy.size())) : 0;
+
+        char meta[160];
+        int len = std::snprintf(meta, sizeof(meta),
+                                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+                                "\"args\":{\"name\":\"psnn thread %u\"}}",
+                                pid, ring->thread_index, ring->thread_index);
+        events.emplace_back(meta, std::min<size_t>(len, sizeof(meta) - 1));
+        for (size_t i = skip; i < copy.size(); i++) {
+            appendEvent(events, copy[i], pid, ring->thread_index, state.origin_ns);
+        }
+    }
+
+    int rc = 0;
+    for (const OrtProfile& profile : ort_profiles) {
+        if (readOrtProfile(profile, state.origin_ns, events) != 0) {
+            rc = 1;
+        }
+    }
+    return rc;
+}
+
+int writeChromeTrace(const std::string& path, const std::vector<std::string>& events) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return 1;
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < events.size(); i++) {
+        out << events[i] << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    return out.good() ? 0 : 1;
+}
+
+int writeTraceEventLines(const std::string& path, const std::vector<std::string>& events) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return 1;
+    }
+    for (const std::string& event : events) {
+        out << event << "\n";
+    }
+    return out.good() ? 0 : 1;
+}
+
+int readTraceEventLines(const std::string& path, std::vector<std::string>& events) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return 1;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty()) events.push_back(line);
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// PSNN_trace.h - Opt-in per-request stage tracing exported as a Chrome trace
+#ifndef PSNN_TRACE_H
+#define PSNN_TRACE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Tracing configuration
+struct TraceOptions {
+    double sample_rate = 1.0;          // Fraction of requests traced, e.g. 0.01 in production
+    size_t ring_spans = 1 << 16;       // Spans kept per thread; older spans are overwritten
+    bool ort_profiling = false;        // Also enable ORT's profiler (records every Run, not sampled)
+    std::string ort_profile_prefix = "psnn_ort_profile";  // File prefix for ORT's profiler output
+};
+
+// Profiler output of one ORT session, from Session::EndProfilingAllocated
+struct OrtProfile {
+    std::string path;
+    uint64_t start_ns;  // Session::GetProfilingStartTimeNs
+};
+
+/**
+ * Turn tracing on. Threads record into their own fixed-size ring buffers, so
+ * recording a span takes no lock. Call before creating sessions so that
+ * ort_profiling can take effect.
+ *
+ * @param options Tracing configuration
+ */
+void enableTracing(const TraceOptions& options);
+
+/**
+ * @return true if enableTracing() has been called
+ */
+bool tracingEnabled();
+
+/**
+ * @return The options passed to enableTracing()
+ */
+const TraceOptions& traceOptions();
+
+/**
+ * Discard every recorded span, e.g. in a forked child so that spans inherited
+ * from the parent are not exported twice.
+ */
+void clearTraceRecords();
+
+/**
+ * Marks the current thread as handling one request (an event or a batch) for
+ * its lifetime. The request is sampled at TraceOptions::sample_rate; spans are
+ * only recorded inside a sampled request.
+ */
+class TraceRequest {
+public:
+    /**
+     * @param always Trace this request regardless of the sample rate (e.g. one-off load stages)
+     */
+    explicit TraceRequest(bool always = false);
+    ~TraceRequest();
+
+    TraceRequest(const TraceRequest&) = delete;
+    TraceRequest& operator=(const TraceRequest&) = delete;
+
+    /**
+     * @return Request id, or 0 if the request is not traced
+     */
+    uint64_t id() const { return request; }
+
+private:
+    uint64_t request;
+    uint64_t previous;
+};
+
+/**
+ * Records one stage of the current request, from construction to destruction.
+ * A no-op outside a sampled request.
+ */
+class TraceSpan {
+public:
+    /**
+     * @param name Stage name; must be a string literal or otherwise outlive the trace
+     */
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    uint64_t start_ns;
+};
+
+/**
+ * Convert the recorded spans of every thread, plus ORT profiler files, into
+ * Chrome trace events on a common timeline. ORT events are shifted by their
+ * session's profiling start time. Spans recorded while this runs may be missed.
+ *
+ * @param ort_profiles ORT profiler outputs to merge (may be empty)
+ * @param events Receives one JSON object per event (appended)
+ * @return 0 on success, non-zero if an ORT profile could not be read
+ */
+int collectTraceEvents(const std::vector<OrtProfile>& ort_profiles, std::vector<std::string>& events);
+
+/**
+ * Write events as a Chrome trace / Perfetto JSON file.
+ *
+ * @param path Output file path
+ * @param events JSON objects from collectTraceEvents()
+ * @return 0 on success, non-zero on failure
+ */
+int writeChromeTrace(const std::string& path, const std::vector<std::string>& events);
+
+/**
+ * Write events one per line, for merging traces from several processes.
+ *
+ * @param path Output file path
+ * @param events JSON objects from collectTraceEvents()
+ * @return 0 on success, non-zero on failure
+ */
+int writeTraceEventLines(const std::string& path, const std::vector<std::string>& events);
+
+/**
+ * Read a file written by writeTraceEventLines().
+ *
+ * @param path Input file path
+ * @param events Receives the events (appended)
+ * @return 0 on success, non-zero on failure
+ */
+int readTraceEventLines(const std::string& path, std::vector<std::string>& events);
+
+#endif // PSNN_TRACE_H
@@ -0,0 +1,320 @@
+// corpus_generator.cpp - Synthetic feature corpus for scale testing
+//
+// Samples realistic RDP events from the per-feature MEANS/STD_DEV tables and
+// writes them in every supported event format. Rows are generated in fixed-size
+// blocks, each seeded from (seed, block index), so the corpus is identical for a
+// given seed regardless of the number of threads.
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <future>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "PSNN_features.h"
+#include "PSNN_io.h"
+
+// Rows generated per independently-seeded block
+static const size_t BLOCK_ROWS = 8192;
+
+// How a feature's values are distributed
+enum class FeatureKind {
+    Continuous,  // Normal(mean, std), optionally clamped
+    Integer,     // Rounded normal, optionally clamped
+    Binary,      // 0/1 with P(1) = mean
+    Count,       // Zero-heavy non-negative counts (hurdle model)
+    Constant     // Dropped features: no variance in the training data
+};
+
+struct FeatureRule {
+    const char* prefix;
+    FeatureKind kind;
+    double lo;
+    double hi;
+};
+
+// First matching prefix wins; unmatched features are unbounded Continuous
+static const FeatureRule RULES[] = {
+    {"SimScore(A)", FeatureKind::Binary, 0.0, 1.0},
+    {"OUIndexA(A)", FeatureKind::Binary, 0.0, 1.0},
+    {"RCompat", FeatureKind::Count, 0.0, HUGE_VAL},
+    {"SRCompat", FeatureKind::Count, 0.0, HUGE_VAL},
+    {"SetTot", FeatureKind::Count, 0.0, HUGE_VAL},
+    {"OUList", FeatureKind::Count, 0.0, HUGE_VAL},
+    {"BadDists", FeatureKind::Count, 0.0, HUGE_VAL},
+    {"Consensus", FeatureKind::Count, 0.0, HUGE_VAL},
+    {"ListCorr(A)", FeatureKind::Integer, 0.0, HUGE_VAL},
+    {"RankF", FeatureKind::Integer, 0.0, HUGE_VAL},
+    {"OuCheck", FeatureKind::Integer, -HUGE_VAL, HUGE_VAL},
+    {"PhPrScore", FeatureKind::Continuous, 0.0, 1.0},
+    {"SubPhPrScore", FeatureKind::Continuous, 0.0, 1.0},
+    {"dMax", FeatureKind::Continuous, 0.0, 1.0},
+    {"SSDist", FeatureKind::Continuous, 0.0, HUGE_VAL},
+    {"SubScore", FeatureKind::Continuous, 0.0, HUGE_VAL},
+    {"TrpScore", FeatureKind::Continuous, 0.0, HUGE_VAL},
+};
+
+// Sampling parameters for one raw feature
+struct FeatureModel {
+    FeatureKind kind;
+    double mean;
+    double std;
+    double lo;
+    double hi;
+    double p_nonzero;  // Count: probability of a non-zero value
+    double lambda;     // Count: non-zero values are 1 + Poisson(lambda)
+};
+
+// splitmix64: used both as the block seeder and the per-block generator so
+// the corpus does not depend on the standard library's distributions
+struct Rng {
+    uint64_t state;
+
+    explicit Rng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in (0, 1)
+    double uniform() {
+        return (static_cast<double>(next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    double normal() {
+        double u1 = uniform();
+        double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+    double poisson(double lambda) {
+        if (lambda <= 0.0) {
+            return 0.0;
+        }
+        if (lambda > 30.0) {
+            return std::max(0.0, std::round(lambda + std::sqrt(lambda) * normal()));
+        }
+        double limit = std::exp(-lambda);
+        double k = 0.0;
+        double p = uniform();
+        while (p > limit) {
+            k += 1.0;
+            p *= uniform();
+        }
+        return k;
+    }
+};
+
+static FeatureModel buildModel(const std::string& name, bool dropped, double mean, double std) {
+    FeatureModel m{FeatureKind::Continuous, mean, std, -HUGE_VAL, HUGE_VAL, 0.0, 0.0};
+
+    if (dropped) {
+        m.kind = FeatureKind::Constant;
+        m.mean = 0.0;
+        return m;
+    }
+
+    for (const auto& rule : RULES) {
+        if (name.compare(0, std::strlen(rule.prefix), rule.prefix) == 0) {
+            m.kind = rule.kind;
+            m.lo = rule.lo;
+            m.hi = rule.hi;
+            break;
+        }
+    }
+
+    if (m.kind == FeatureKind::Count) {
+        // Match the first two moments with P(X>0) = q, X|X>0 ~ 1 + Poisson(lambda):
+        // E[X^2]/E[X] = u + 1 - 1/u with u = 1 + lambda, and q = mean / u
+        if (mean <= 0.0) {
+            m.kind = FeatureKind::Constant;
+            m.mean = 0.0;
+        } else {
+            double r = (std * std + mean * mean) / mean;
+            double u = ((r - 1.0) + std::sqrt((r - 1.0) * (r - 1.0) + 4.0)) / 2.0;
+            m.lambda = u - 1.0;
+            m.p_nonzero = std::min(1.0, mean / u);
+        }
+    }
+
+    return m;
+}
+
+static double sample(const FeatureModel& m, Rng& rng) {
+    double v = 0.0;
+    switch (m.kind) {
+        case FeatureKind::Constant:
+            return m.mean;
+        case FeatureKind::Binary:
+            return rng.uniform() < m.mean ? 1.0 : 0.0;
+        case FeatureKind::Count:
+            return rng.uniform() < m.p_nonzero ? 1.0 + rng.poisson(m.lambda) : 0.0;
+        case FeatureKind::Integer:
+            v = std::round(m.mean + m.std * rng.normal());
+            break;
+        case FeatureKind::Continuous:
+            // Keep the precision RDP prints so every format round-trips the same value
+            v = std::round((m.mean + m.std * rng.normal()) * 1e6) / 1e6;
+            break;
+    }
+    return std::min(m.hi, std::max(m.lo, v));
+}
+
+// With scan_changes > 0, each row after the first of a block copies the previous
+// row and resamples scan_changes of its non-constant features, like consecutive
+// windows of an alignment scan
+static void generateBlock(const std::vector<FeatureModel>& models, uint64_t seed, uint64_t block,
+                          size_t n_rows, size_t scan_changes, double* out) {
+    Rng rng(Rng(seed ^ (block * 0xD1B54A32D192ED03ULL)).next());
+    std::vector<size_t> varying;
+    for (size_t i = 0; i < FEATURE_COUNT; i++) {
+        if (models[i].kind != FeatureKind::Constant) varying.push_back(i);
+    }
+
+    for (size_t r = 0; r < n_rows; r++) {
+        double* row = out + r * FEATURE_COUNT;
+        if (r == 0 || scan_changes == 0 || varying.empty()) {
+            for (size_t i = 0; i < FEATURE_COUNT; i++) {
+                row[i] = sample(models[i], rng);
+            }
+            continue;
+        }
+        std::memcpy(row, row - FEATURE_COUNT, FEATURE_COUNT * sizeof(double));
+        for (size_t c = 0; c < scan_changes; c++) {
+            size_t i = varying[rng.next() % varying.size()];
+            row[i] = sample(models[i], rng);
+        }
+    }
+}
+
+static void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--rows N] [--seed S] [--threads T] [--format txt|csv|bin|sparse|all] [--out PREFIX]"
+              << " [--scan-changes K]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    uint64_t n_rows = 1000000;
+    uint64_t seed = 1;
+    size_t n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string format_name = "all";
+    std::string prefix = "corpus";
+    size_t scan_changes = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--rows") {
+            n_rows = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed") {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--threads") {
+            n_threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--format") {
+            format_name = argv[++i];
+        } else if (arg == "--out") {
+            prefix = argv[++i];
+        } else if (arg == "--scan-changes") {
+            scan_changes = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<EventFormat> formats;
+    if (format_name == "all") {
+        formats = {EventFormat::SharedData, EventFormat::Csv, EventFormat::Binary, EventFormat::Sparse};
+    } else {
+        EventFormat format;
+        if (!parseEventFormat(format_name, format)) {
+            std::cerr << "Error: Unknown format '" << format_name << "'." << std::endl;
+            return 1;
+        }
+        formats.push_back(format);
+    }
+
+    // Build a sampling model for each raw feature
+    std::vector<FeatureModel> models;
+    const auto& kept = keptFeatureIndices();
+    size_t k = 0;
+    for (size_t i = 0; i < FEATURE_COUNT; i++) {
+        bool is_kept = k < kept.size() && kept[k] == i;
+        models.push_back(buildModel(FEATURE_NAMES[i], !is_kept,
+                                    is_kept ? MEANS[k] : 0.0, is_kept ? STD_DEV[k] : 0.0));
+        if (is_kept) k++;
+    }
+
+    std::vector<EventWriter> writers(formats.size());
+    for (size_t f = 0; f < formats.size(); f++) {
+        std::string path = prefix + "." + eventFormatExtension(formats[f]);
+        if (writers[f].open(path, formats[f]) != 0) {
+            return 1;
+        }
+    }
+
+    // Generate one round of blocks while the previous round is being written
+    uint64_t n_blocks = (n_rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    size_t round_rows = n_threads * BLOCK_ROWS;
+    std::vector<double> buffers[2] = {
+        std::vector<double>(round_rows * FEATURE_COUNT),
+        std::vector<double>(round_rows * FEATURE_COUNT)
+    };
+    std::vector<std::future<int>> pending;
+    int status = 0;
+
+    for (uint64_t first = 0, round = 0; first < n_blocks; first += n_threads, round++) {
+        std::vector<double>& buffer = buffers[round % 2];
+        uint64_t last = std::min<uint64_t>(n_blocks, first + n_threads);
+
+        std::vector<std::thread> workers;
+        for (uint64_t b = first; b < last; b++) {
+            size_t rows = static_cast<size_t>(std::min<uint64_t>(BLOCK_ROWS, n_rows - b * BLOCK_ROWS));
+            double* out = buffer.data() + (b - first) * BLOCK_ROWS * FEATURE_COUNT;
+            workers.emplace_back(generateBlock, std::cref(models), seed, b, rows, scan_changes, out);
+        }
+        for (auto& t : workers) {
+            t.join();
+        }
+
+        for (auto& p : pending) {
+            status |= p.get();
+        }
+        pending.clear();
+
+        size_t rows = static_cast<size_t>(std::min<uint64_t>(n_rows, last * BLOCK_ROWS) - first * BLOCK_ROWS);
+        for (auto& writer : writers) {
+            pending.push_back(std::async(std::launch::async, [&writer, &buffer, rows] {
+                return writer.write(buffer.data(), rows);
+            }));
+        }
+    }
+
+    for (auto& p : pending) {
+        status |= p.get();
+    }
+    for (auto& writer : writers) {
+        status |= writer.close();
+    }
+
+    if (status != 0) {
+        std::cerr << "Error: Failed to write corpus." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << n_rows << " events (seed " << seed << ") to " << prefix << ".{";
+    for (size_t f = 0; f < formats.size(); f++) {
+        std::cout << (f > 0 ? "," : "") << eventFormatExtension(formats[f]);
+    }
+    std::cout << "}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,262 @@
+// psnn_plan_gen.cpp - Compile PSNN_params.csv into PSNN_plan.h, the preprocessing plan every PSNN binary uses
+//
+// The plan is the drop list and standardisation constants as constexpr tables:
+// the raw index of each model input (gather), and per input a scale and offset
+// so that standardising is one multiply-add. The model is read only for its
+// shape; a parameter file that does not keep exactly as many features as the
+// model takes inputs is an error, so the build stops rather than producing
+// binaries that feed the model the wrong columns.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "PSNN_native.h"
+
+// Standard deviations below this mark a constant feature, which standardises to 0
+static const double MIN_STD_DEV = 1e-10;
+
+struct PlanFeature {
+    std::string name;
+    bool keep = false;
+    double mean = 0.0;
+    double std_dev = 0.0;
+};
+
+static std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    size_t end = s.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? std::string() : s.substr(begin, end - begin + 1);
+}
+
+static bool parseDouble(const std::string& text, double& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return *end == '\0' && std::isfinite(value);
+}
+
+/**
+ * Read the parameter file: comment lines start with '#', then a
+ * "name,keep,mean,std" header and one row per raw feature in canonical order.
+ *
+ * @param path Parameter file path
+ * @param features Receives the rows
+ * @return 0 on success, non-zero on failure
+ */
+static int readParams(const std::string& path, std::vector<PlanFeature>& features) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return 1;
+    }
+    std::unordered_set<std::string> seen;
+    bool header = false;
+    std::string line;
+    for (size_t line_no = 1; std::getline(in, line); line_no++) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            fields.push_back(trim(field));
+        }
+        if (line.back() == ',') {
+            fields.push_back("");
+        }
+        if (!header) {
+            if (fields.size() != 4 || fields[0] != "name" || fields[1] != "keep" || fields[2] != "mean" ||
+                fields[3] != "std") {
+                std::cerr << "Error: " << path << ":" << line_no << ": expected the header name,keep,mean,std" << std::endl;
+                return 1;
+            }
+            header = true;
+            continue;
+        }
+
+        PlanFeature feature;
+        if (fields.size() != 4 || fields[0].empty() || (fields[1] != "0" && fields[1] != "1")) {
+            std::cerr << "Error: " << path << ":" << line_no << ": expected name,keep(0|1),mean,std" << std::endl;
+            return 1;
+        }
+        feature.name = fields[0];
+        feature.keep = fields[1] == "1";
+        if (feature.keep && (!parseDouble(fields[2], feature.mean) || !parseDouble(fields[3], feature.std_dev) ||
+                             feature.std_dev < 0.0)) {
+            std::cerr << "Error: " << path << ":" << line_no << ": kept feature " << feature.name
+                      << " needs a finite mean and a non-negative standard deviation" << std::endl;
+            return 1;
+        }
+        if (feature.name.find_first_of("\"\\") != std::string::npos) {
+            std::cerr << "Error: " << path << ":" << line_no << ": feature names may not contain quotes or backslashes"
+                      << std::endl;
+            return 1;
+        }
+        if (!seen.insert(feature.name).second) {
+            std::cerr << "Error: " << path << ":" << line_no << ": feature " << feature.name << " is listed twice"
+                      << std::endl;
+            return 1;
+        }
+        features.push_back(feature);
+    }
+    if (features.empty()) {
+        std::cerr << "Error: " << path << " lists no features." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Width of a [batch, width] model input or output, or 0 if the shape is not that
+static size_t modelWidth(const std::vector<OnnxValueInfo>& values) {
+    if (values.empty() || values[0].dims.size() != 2 || values[0].dims[1] <= 0) {
+        return 0;
+    }
+    return static_cast<size_t>(values[0].dims[1]);
+}
+
+// Write the elements of a table, several to a line
+template <typename T, typename Format>
+static void writeTable(std::ostream& out, const std::vector<T>& values, size_t per_line, Format format) {
+    for (size_t i = 0; i < values.size(); i++) {
+        out << (i % per_line == 0 ? "\n    " : " ") << format(values[i]) << (i + 1 < values.size() ? "," : "");
+    }
+    out << "\n";
+}
+
+// File name without its directory, so the generated header does not depend on where it was built
+static std::string baseName(const std::string& path) {
+    return path.substr(path.find_last_of("/\\") + 1);
+}
+
+static std::string formatDouble(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    return buffer;
+}
+
+static std::string formatFloat(float value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9gf", static_cast<double>(value));
+    return buffer;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " PARAMS.csv MODEL.onnx OUTPUT.h" << std::endl;
+        return 1;
+    }
+    std::string params_path = argv[1];
+    std::string model_path = argv[2];
+    std::string output_path = argv[3];
+
+    std::vector<PlanFeature> features;
+    if (readParams(params_path, features) != 0) {
+        return 1;
+    }
+
+    std::vector<size_t> gather;
+    std::vector<int> position;
+    std::vector<double> means, std_devs, scales, offsets;
+    std::vector<float> zero_row;
+    for (size_t i = 0; i < features.size(); i++) {
+        const PlanFeature& f = features[i];
+        position.push_back(f.keep ? static_cast<int>(gather.size()) : -1);
+        if (!f.keep) {
+            continue;
+        }
+        gather.push_back(i);
+        means.push_back(f.mean);
+        std_devs.push_back(f.std_dev);
+        // (x - mean) / std as x * scale + offset; a constant feature is always 0
+        bool constant = f.std_dev < MIN_STD_DEV;
+        scales.push_back(constant ? 0.0 : 1.0 / f.std_dev);
+        offsets.push_back(constant ? 0.0 : -f.mean / f.std_dev);
+        zero_row.push_back(static_cast<float>(offsets.back()));
+    }
+
+    OnnxGraph graph;
+    if (loadOnnxGraph(model_path, graph) != 0) {
+        return 1;
+    }
+    size_t input_width = modelWidth(graph.inputs);
+    size_t num_classes = modelWidth(graph.outputs);
+    if (input_width == 0 || num_classes == 0) {
+        std::cerr << "Error: " << model_path << " does not have a [batch, width] input and output." << std::endl;
+        return 1;
+    }
+    if (input_width != gather.size()) {
+        std::cerr << "Error: " << model_path << " takes " << input_width << " inputs, but " << params_path << " keeps "
+                  << gather.size() << " of its " << features.size() << " features." << std::endl;
+        return 1;
+    }
+
+    std::ostringstream out;
+    out << "// PSNN_plan.h - Preprocessing plan generated by psnn_plan_gen from " << baseName(params_path) << " and "
+        << baseName(model_path) << "\n"
+        << "// Do not edit; change the parameter file and rebuild.\n"
+        << "#ifndef PSNN_PLAN_H\n"
+        << "#define PSNN_PLAN_H\n\n"
+        << "#include <array>\n"
+        << "#include <cstdint>\n"
+        << "#include <cstddef>\n\n"
+        << "// Raw features per event, features fed to the model, and classes it predicts\n"
+        << "inline constexpr size_t PLAN_FEATURE_COUNT = " << features.size() << ";\n"
+        << "inline constexpr size_t PLAN_KEPT_COUNT = " << gather.size() << ";\n"
+        << "inline constexpr size_t PLAN_NUM_CLASSES = " << num_classes << ";\n\n";
+
+    out << "// Raw feature names in canonical order\n"
+        << "inline constexpr std::array<const char*, PLAN_FEATURE_COUNT> PLAN_FEATURE_NAMES{";
+    std::vector<std::string> names;
+    for (const PlanFeature& f : features) names.push_back(f.name);
+    writeTable(out, names, 6, [](const std::string& s) { return "\"" + s + "\""; });
+    out << "};\n\n";
+
+    out << "// Model input position of each raw feature, or -1 if it is dropped\n"
+        << "alignas(64) inline constexpr std::array<int16_t, PLAN_FEATURE_COUNT> PLAN_POSITION{";
+    writeTable(out, position, 20, [](int p) { return std::to_string(p); });
+    out << "};\n\n";
+
+    out << "// Raw feature index of each model input\n"
+        << "alignas(64) inline constexpr std::array<uint16_t, PLAN_KEPT_COUNT> PLAN_GATHER{";
+    writeTable(out, gather, 20, [](size_t g) { return std::to_string(g); });
+    out << "};\n\n";
+
+    out << "// Training means and standard deviations of the model inputs\n"
+        << "alignas(64) inline constexpr std::array<double, PLAN_KEPT_COUNT> PLAN_MEANS{";
+    writeTable(out, means, 4, formatDouble);
+    out << "};\n"
+        << "alignas(64) inline constexpr std::array<double, PLAN_KEPT_COUNT> PLAN_STD_DEV{";
+    writeTable(out, std_devs, 4, formatDouble);
+    out << "};\n\n";
+
+    out << "// Standardised input = raw * PLAN_SCALE + PLAN_OFFSET; both are 0 for a constant feature\n"
+        << "alignas(64) inline constexpr std::array<double, PLAN_KEPT_COUNT> PLAN_SCALE{";
+    writeTable(out, scales, 4, formatDouble);
+    out << "};\n"
+        << "alignas(64) inline constexpr std::array<double, PLAN_KEPT_COUNT> PLAN_OFFSET{";
+    writeTable(out, offsets, 4, formatDouble);
+    out << "};\n\n";
+
+    out << "// The standardised form of an all-zero event\n"
+        << "alignas(64) inline constexpr std::array<float, PLAN_KEPT_COUNT> PLAN_ZERO_ROW{";
+    writeTable(out, zero_row, 6, formatFloat);
+    out << "};\n\n"
+        << "#endif // PSNN_PLAN_H\n";
+
+    std::ofstream file(output_path, std::ios::binary);
+    if (!file.is_open() || !(file << out.str()) || !file.flush()) {
+        std::cerr << "Error: Could not write " << output_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+// psnn_replay.cpp - Replay a recording of PSNN_Predict calls against an engine and compare the results
+//
+// Requests are sent one at a time in recorded order, each at its recorded
+// arrival time (optionally sped up) or back to back. Response latency is
+// measured from the time a request was due, so an engine that falls behind
+// the recorded traffic shows the queueing it would have caused. The report
+// gives recorded and replayed latency percentiles and how far the replayed
+// probabilities are from the recorded ones.
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "PSNN_features.h"
+#include "PSNN_model.h"
+#include "PSNN_record.h"
+
+static void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " RECORDING [--model PATH] [--backend NAME|stream]"
+              << " [--speed X | --fast] [--tolerance T]" << std::endl;
+}
+
+// q-quantile of the values, in microseconds
+static double quantileUs(std::vector<uint64_t>& ns, double q) {
+    if (ns.empty()) {
+        return 0.0;
+    }
+    size_t i = static_cast<size_t>(q * static_cast<double>(ns.size() - 1) + 0.5);
+    std::nth_element(ns.begin(), ns.begin() + i, ns.end());
+    return static_cast<double>(ns[i]) / 1000.0;
+}
+
+static void printLatency(const char* label, std::vector<uint64_t>& ns) {
+    std::printf("%-18s p50 %9.1f  p99 %9.1f  p99.9 %9.1f  max %9.1f us\n", label, quantileUs(ns, 0.5),
+                quantileUs(ns, 0.99), quantileUs(ns, 0.999), quantileUs(ns, 1.0));
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::string recording_path = argv[1];
+    std::string model_path = "RDP_TripleNN.onnx";
+    std::string backend = "auto";
+    double speed = 1.0;
+    bool fast = false;
+    double tolerance = -1.0;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--fast") {
+            fast = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--model") {
+            model_path = argv[++i];
+        } else if (arg == "--backend") {
+            backend = argv[++i];
+        } else if (arg == "--speed") {
+            speed = std::atof(argv[++i]);
+        } else if (arg == "--tolerance") {
+            tolerance = std::atof(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (!(speed > 0.0)) {
+        std::cerr << "Error: --speed must be positive." << std::endl;
+        return 1;
+    }
+
+    Recording recording;
+    if (loadRecording(recording_path, recording) != 0) {
+        return 1;
+    }
+    size_t n_requests = recording.requests.size();
+    if (n_requests == 0) {
+        std::cerr << "Error: " << recording_path << " has no requests." << std::endl;
+        return 1;
+    }
+
+    // The engine under test: a PSNNModel backend, or a PSNNStream over the requests in order
+    std::unique_ptr<PSNNModel> model;
+    std::unique_ptr<PSNNStream> stream;
+    try {
+        if (backend == "stream") {
+            stream.reset(new PSNNStream(model_path));
+        } else {
+            PSNNModelOptions options;
+            options.backend = backend;
+            model.reset(new PSNNModel(model_path, options));
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    size_t input_size = model ? model->inputSize() : stream->inputSize();
+    size_t output_size = model ? model->outputSize() : stream->outputSize();
+    if (input_size != KEPT_FEATURE_COUNT || output_size != NUM_CLASSES) {
+        std::cerr << "Error: " << model_path << " does not take " << KEPT_FEATURE_COUNT << " features." << std::endl;
+        return 1;
+    }
+
+    std::vector<float> inputs(KEPT_FEATURE_COUNT);
+    std::vector<float> probs(NUM_CLASSES);
+    std::vector<uint64_t> recorded_ns, service_ns, response_ns;
+    recorded_ns.reserve(n_requests);
+    service_ns.reserve(n_requests);
+    response_ns.reserve(n_requests);
+    double max_diff = 0.0;
+    size_t class_changes = 0;
+    size_t status_changes = 0;
+    size_t failed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const RecordedRequest& request : recording.requests) {
+        auto due = start;
+        if (!fast) {
+            due += std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(request.time_ns) / speed));
+            // Sleep until shortly before the request is due, then spin so it starts on time
+            auto wake = due - std::chrono::microseconds(100);
+            if (std::chrono::steady_clock::now() < wake) {
+                std::this_thread::sleep_until(wake);
+            }
+            while (std::chrono::steady_clock::now() < due) {
+            }
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        const RecordedLayout& layout = recording.layouts[request.layout];
+        bool ok = standardiseRecorded(layout, recording.values.data() + request.first_value, inputs.data()) == 0;
+        if (ok) {
+            ok = model ? model->predict(std::span<const float>(inputs), std::span<float>(probs)) == 0
+                       : stream->predict(std::span<const float>(inputs), std::span<float>(probs)) == 0;
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (fast) {
+            due = begin;
+        }
+
+        recorded_ns.push_back(request.latency_ns);
+        service_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        response_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - due).count());
+
+        if (!ok) failed++;
+        if (ok != (request.predicted_class >= 0)) {
+            status_changes++;
+            continue;
+        }
+        if (!ok) {
+            continue;
+        }
+        for (size_t c = 0; c < NUM_CLASSES; c++) {
+            max_diff = std::max(max_diff, static_cast<double>(std::fabs(probs[c] - request.probs[c])));
+        }
+        if (static_cast<int32_t>(PSNNModel::getMaxProbabilityClass(std::span<const float>(probs))) !=
+            request.predicted_class) {
+            class_changes++;
+        }
+    }
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double recorded_s = static_cast<double>(recording.requests.back().time_ns) / 1e9;
+
+    std::printf("requests          %zu\n", n_requests);
+    std::printf("engine            %s\n", model ? model->backendName(1).c_str() : "stream");
+    std::printf("timing            %s\n", fast ? "as fast as possible" : (speed == 1.0 ? "original" : "scaled"));
+    std::printf("recorded span     %.3f s (%.0f requests/s)\n", recorded_s,
+                recorded_s > 0.0 ? n_requests / recorded_s : 0.0);
+    std::printf("replayed in       %.3f s (%.0f requests/s)\n", elapsed_s, n_requests / elapsed_s);
+    printLatency("recorded latency", recorded_ns);
+    printLatency("service time", service_ns);
+    printLatency("response time", response_ns);
+    std::printf("failed            %zu\n", failed);
+    std::printf("status changes    %zu\n", status_changes);
+    std::printf("class changes     %zu\n", class_changes);
+    std::printf("max |diff|        %.3g\n", max_diff);
+
+    if (tolerance >= 0.0 && (max_diff > tolerance || class_changes > 0 || status_changes > 0)) {
+        std::cerr << "Error: Replayed results differ from the recording." << std::endl;
+        return 2;
+    }
+    return 0;
+}
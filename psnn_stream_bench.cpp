@@ -0,0 +1,145 @@
+// psnn_stream_bench.cpp - Compare full and incremental (NativeStream) evaluation on a recorded scan
+//
+// The events of the file are treated as one sequence, in file order. Each is
+// evaluated once with NativeModel::run and once through a NativeStream; the
+// report gives the time per event of both, the speedup, how the stream handled
+// the events and the largest difference between the two results.
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "PSNN_features.h"
+#include "PSNN_io.h"
+#include "PSNN_native.h"
+
+static void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " SCAN_FILE [--model PATH] [--format txt|csv|bin|sparse]"
+              << " [--max-changed K] [--refresh N] [--repeat R]" << std::endl;
+}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::string scan_path = argv[1];
+    std::string model_path = "RDP_TripleNN.onnx";
+    std::string format_name;
+    size_t max_changed = 16;
+    size_t refresh_interval = 1024;
+    int repeat = 5;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--model") {
+            model_path = argv[++i];
+        } else if (arg == "--format") {
+            format_name = argv[++i];
+        } else if (arg == "--max-changed") {
+            max_changed = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--refresh") {
+            refresh_interval = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--repeat") {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    EventFormat format;
+    bool known = format_name.empty() ? eventFormatFromPath(scan_path, format) : parseEventFormat(format_name, format);
+    if (!known) {
+        std::cerr << "Error: Unknown input format; use --format." << std::endl;
+        return 1;
+    }
+
+    std::vector<double> raw;
+    if (loadEvents(scan_path, format, raw) != 0) {
+        return 1;
+    }
+    size_t n_events = raw.size() / FEATURE_COUNT;
+    if (n_events == 0) {
+        std::cerr << "Error: " << scan_path << " has no events." << std::endl;
+        return 1;
+    }
+
+    OnnxGraph graph;
+    NativeModel model;
+    if (loadOnnxGraph(model_path, graph) != 0 || model.load(graph) != 0) {
+        std::cerr << "Error: The native kernels could not load " << model_path << std::endl;
+        return 1;
+    }
+    if (model.inputSize() != KEPT_FEATURE_COUNT || model.outputSize() != NUM_CLASSES) {
+        std::cerr << "Error: " << model_path << " does not take " << KEPT_FEATURE_COUNT << " features." << std::endl;
+        return 1;
+    }
+
+    std::vector<float> inputs(n_events * KEPT_FEATURE_COUNT);
+    for (size_t r = 0; r < n_events; r++) {
+        standardiseRow(raw.data() + r * FEATURE_COUNT, inputs.data() + r * KEPT_FEATURE_COUNT);
+    }
+    std::vector<float> full_out(n_events * NUM_CLASSES);
+    std::vector<float> stream_out(n_events * NUM_CLASSES);
+
+    // Best of several passes, alternating the two so both see the same machine state
+    double full_ns = 0.0;
+    double stream_ns = 0.0;
+    NativeStreamStats stats;
+    for (int pass = 0; pass < repeat; pass++) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < n_events; r++) {
+            model.run(inputs.data() + r * KEPT_FEATURE_COUNT, 1, full_out.data() + r * NUM_CLASSES);
+        }
+        double ns = elapsedNs(start);
+        full_ns = pass == 0 ? ns : std::min(full_ns, ns);
+
+        NativeStream stream(model, max_changed, refresh_interval);
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < n_events; r++) {
+            stream.predict(inputs.data() + r * KEPT_FEATURE_COUNT, stream_out.data() + r * NUM_CLASSES);
+        }
+        ns = elapsedNs(start);
+        stream_ns = pass == 0 ? ns : std::min(stream_ns, ns);
+        stats = stream.stats();
+    }
+
+    double max_diff = 0.0;
+    size_t class_changes = 0;
+    for (size_t r = 0; r < n_events; r++) {
+        const float* a = full_out.data() + r * NUM_CLASSES;
+        const float* b = stream_out.data() + r * NUM_CLASSES;
+        for (size_t c = 0; c < NUM_CLASSES; c++) {
+            max_diff = std::max(max_diff, static_cast<double>(std::fabs(a[c] - b[c])));
+        }
+        if (std::max_element(a, a + NUM_CLASSES) - a != std::max_element(b, b + NUM_CLASSES) - b) {
+            class_changes++;
+        }
+    }
+
+    std::printf("events            %zu\n", n_events);
+    std::printf("full              %.3f us/event\n", full_ns / 1000.0 / n_events);
+    std::printf("stream            %.3f us/event\n", stream_ns / 1000.0 / n_events);
+    std::printf("speedup           %.2fx\n", full_ns / stream_ns);
+    std::printf("stream full       %llu\n", static_cast<unsigned long long>(stats.full));
+    std::printf("stream updates    %llu (%.2f columns each)\n", static_cast<unsigned long long>(stats.incremental),
+                stats.incremental ? static_cast<double>(stats.columns_updated) / stats.incremental : 0.0);
+    std::printf("stream unchanged  %llu\n", static_cast<unsigned long long>(stats.unchanged));
+    std::printf("max |diff|        %.3g\n", max_diff);
+    std::printf("class changes     %zu\n", class_changes);
+    return 0;
+}
@@ -107,13 +107,13 @@ int main() {
     std::vector<std::string> names = {
         "ListCorr(A)1", "ListCorr(A)2", "ListCorr(A)3",
         "SimScoreB(A)1", "SimScoreB(A)2", "SimScoreB(A)3",
-        // ... all 117 feature names
+        // ... all 120 feature names
     };
     
     std::vector<double> values = {
         19.0, 30.0, 20.0,
         0.22937, 0.01384, -0.01384,
-        // ... all 117 values
+        // ... all 120 values
     };
     
     // Make prediction